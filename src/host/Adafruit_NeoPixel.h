@@ -0,0 +1,47 @@
+// Host replacement for the Adafruit NeoPixel library: keeps the pixels in
+// RAM and provides the static color helpers (Color, ColorHSV, gamma32) the
+// effects use. show() only counts frames.
+
+#ifndef __HOST_ADAFRUIT_NEOPIXEL_H__
+#define __HOST_ADAFRUIT_NEOPIXEL_H__
+
+#include <Arduino.h>
+
+#define NEO_RGB 0x06
+#define NEO_GRB 0x52
+#define NEO_BRG 0x58
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+class Adafruit_NeoPixel {
+  public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+    ~Adafruit_NeoPixel();
+
+    void begin() {}
+    void show() { shows++; }
+    void clear();
+    void setBrightness(uint8_t b) { brightness = b; }
+    uint8_t getBrightness() const { return brightness; }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setPixelColor(uint16_t n, uint32_t c);
+    uint32_t getPixelColor(uint16_t n) const;
+    uint8_t *getPixels() const { return pixels; }
+    uint16_t numPixels() const { return numLEDs; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+      return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+    static uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255);
+    static uint8_t gamma8(uint8_t x);
+    static uint32_t gamma32(uint32_t x);
+
+    unsigned long shows = 0;
+  private:
+    uint16_t numLEDs;
+    uint8_t brightness = 0;
+    uint8_t *pixels;
+};
+
+#endif // __HOST_ADAFRUIT_NEOPIXEL_H__
@@ -0,0 +1,82 @@
+// Minimal Arduino runtime for building the sketch natively on Linux.
+// Time is virtual: millis()/micros() only move when the simulation
+// advances the clock (or a sketch calls delay()), so runs are repeatable.
+
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW  0
+#define OUTPUT 1
+#define INPUT  0
+#define A0 17
+#define D6 12
+#define BUILTIN_LED 2
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Virtual clock control for the host simulation
+void hostAdvanceMicros(unsigned long us);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+int analogRead(uint8_t pin);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+void pinMode(uint8_t pin, uint8_t mode);
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    size_t print(const char* s);
+    size_t print(long n);
+    size_t println(const char* s = "");
+    size_t println(long n);
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    // Unlike Arduino's this does not wait for missing bytes
+    size_t readBytes(uint8_t* buffer, size_t length);
+};
+
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud) {}
+    size_t setRxBufferSize(size_t size) { return size; }
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(uint8_t c);
+};
+
+extern HardwareSerial Serial;
+
+#endif // __HOST_ARDUINO_H__
@@ -0,0 +1,163 @@
+// Implementation of the host Arduino/NeoPixel replacements.
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <stdio.h>
+
+static uint64_t clockMicros = 0;
+static uint32_t randomState = 1;
+
+HardwareSerial Serial;
+
+unsigned long millis() { return clockMicros / 1000; }
+unsigned long micros() { return clockMicros; }
+void delay(unsigned long ms) { clockMicros += (uint64_t) ms * 1000; }
+void delayMicroseconds(unsigned int us) { clockMicros += us; }
+void hostAdvanceMicros(unsigned long us) { clockMicros += us; }
+
+// Same generator on every platform, so a seeded run renders the same frames
+static uint32_t nextRandom() {
+  randomState = randomState * 1103515245 + 12345;
+  return (randomState >> 1) & 0x7fffffff;
+}
+
+long random(long howbig) {
+  if(howbig <= 0) {
+    return 0;
+  }
+  return nextRandom() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if(howsmall >= howbig) {
+    return howsmall;
+  }
+  return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if(seed != 0) {
+    randomState = seed;
+  }
+}
+
+int analogRead(uint8_t pin) { return 0; }
+int digitalRead(uint8_t pin) { return LOW; }
+void digitalWrite(uint8_t pin, uint8_t val) {}
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+size_t Print::print(const char* s) {
+  size_t n = 0;
+  while(*s) {
+    n += write(*s++);
+  }
+  return n;
+}
+
+size_t Print::print(long n) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%ld", n);
+  return print(buf);
+}
+
+size_t Print::println(const char* s) { return print(s) + print("\r\n"); }
+size_t Print::println(long n) { return print(n) + print("\r\n"); }
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+  size_t n = 0;
+  while(n < length) {
+    int c = read();
+    if(c < 0) {
+      break;
+    }
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fputc(c, stderr) == EOF ? 0 : 1;
+}
+
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t pin, neoPixelType type) : numLEDs(n) {
+  pixels = (uint8_t *) calloc(n, 3);
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel() {
+  free(pixels);
+}
+
+void Adafruit_NeoPixel::clear() {
+  memset(pixels, 0, numLEDs * 3);
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  if(n < numLEDs) {
+    uint8_t *p = &pixels[n * 3];
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+  }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
+  setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
+  if(n >= numLEDs) {
+    return 0;
+  }
+  const uint8_t *p = &pixels[n * 3];
+  return Color(p[0], p[1], p[2]);
+}
+
+// Same piecewise hue ramp as the Adafruit library: 6 sectors of 256 steps
+uint32_t Adafruit_NeoPixel::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val) {
+  uint8_t r, g, b;
+
+  hue = (hue * 1530L + 32768) / 65536;
+  if(hue < 510) {
+    b = 0;
+    if(hue < 255) { r = 255; g = hue; }
+    else          { r = 510 - hue; g = 255; }
+  } else if(hue < 1020) {
+    r = 0;
+    if(hue < 765) { g = 255; b = hue - 510; }
+    else          { g = 1020 - hue; b = 255; }
+  } else if(hue < 1530) {
+    g = 0;
+    if(hue < 1275) { r = hue - 1020; b = 255; }
+    else           { r = 255; b = 1530 - hue; }
+  } else {
+    r = 255; g = 0; b = 0;
+  }
+
+  uint32_t v1 = 1 + val;
+  uint16_t s1 = 1 + sat;
+  uint8_t s2 = 255 - sat;
+  return ((((((r * s1) >> 8) + s2) * v1) & 0xff00) << 8) |
+          (((((g * s1) >> 8) + s2) * v1) & 0xff00) |
+         (((((b * s1) >> 8) + s2) * v1) >> 8);
+}
+
+uint8_t Adafruit_NeoPixel::gamma8(uint8_t x) {
+  static uint8_t table[256];
+  static bool ready = false;
+  if(!ready) {
+    for(int i = 0; i < 256; i++) {
+      table[i] = (uint8_t)(pow(i / 255.0, 2.6) * 255.0 + 0.5);
+    }
+    ready = true;
+  }
+  return table[x];
+}
+
+uint32_t Adafruit_NeoPixel::gamma32(uint32_t x) {
+  uint8_t *y = (uint8_t *)&x;
+  for(uint8_t i = 0; i < 4; i++) {
+    y[i] = gamma8(y[i]);
+  }
+  return x;
+}
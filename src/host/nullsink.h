@@ -0,0 +1,42 @@
+#ifndef __NULLSINK_H__
+#define __NULLSINK_H__
+
+#include "pixelsink.h"
+
+// Pixel sink that keeps the pixels (effects read them back) but never
+// sends them anywhere; used to time the effects on their own.
+class NullSink : public PixelSink {
+
+  public:
+    NullSink(uint16_t n) : numLEDs(n) { pixels = (uint8_t*) calloc(n, 3); }
+    ~NullSink() { free(pixels); }
+
+    uint16_t numPixels() const { return numLEDs; }
+    void setBrightness(uint8_t b) {}
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+      if(n < numLEDs) {
+        uint8_t* p = &pixels[n * 3];
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+      }
+    }
+    using PixelSink::setPixelColor;
+    uint32_t getPixelColor(uint16_t n) const {
+      if(n >= numLEDs) {
+        return 0;
+      }
+      const uint8_t* p = &pixels[n * 3];
+      return Color(p[0], p[1], p[2]);
+    }
+    void clear() { memset(pixels, 0, numLEDs * 3); }
+    void show() { frames++; }
+
+    unsigned long frames = 0;
+
+  private:
+    uint16_t numLEDs;
+    uint8_t* pixels;
+};
+
+#endif // __NULLSINK_H__
@@ -0,0 +1,41 @@
+#include "recordingsink.h"
+
+RecordingSink::RecordingSink(uint16_t n, FILE* out) : numLEDs(n), out(out) {
+  pixels = (uint8_t*) calloc(n, 3);
+}
+
+RecordingSink::~RecordingSink() {
+  free(pixels);
+}
+
+void RecordingSink::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  if(n < numLEDs) {
+    uint8_t* p = &pixels[n * 3];
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+  }
+}
+
+uint32_t RecordingSink::getPixelColor(uint16_t n) const {
+  if(n >= numLEDs) {
+    return 0;
+  }
+  const uint8_t* p = &pixels[n * 3];
+  return Color(p[0], p[1], p[2]);
+}
+
+void RecordingSink::clear() {
+  memset(pixels, 0, numLEDs * 3);
+}
+
+void RecordingSink::show() {
+  for(int i = 0; i < numLEDs * 3; i++) {
+    hash = (hash ^ pixels[i]) * 16777619UL;
+  }
+  if(out != nullptr) {
+    fprintf(out, "P6\n%d 1\n255\n", numLEDs);
+    fwrite(pixels, 3, numLEDs, out);
+  }
+  frames++;
+}
@@ -0,0 +1,37 @@
+#ifndef __RECORDINGSINK_H__
+#define __RECORDINGSINK_H__
+
+#include <stdio.h>
+#include "pixelsink.h"
+
+// Pixel sink for the host build. Every show() appends the frame as a binary
+// PPM image (P6, numPixels x 1) to 'out' when given, and folds it into a
+// running FNV-1a hash so two runs can be compared for determinism.
+class RecordingSink : public PixelSink {
+
+  public:
+    RecordingSink(uint16_t n, FILE* out = nullptr);
+    ~RecordingSink();
+
+    uint16_t numPixels() const { return numLEDs; }
+    void setBrightness(uint8_t b) { brightness = b; }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    using PixelSink::setPixelColor;
+    uint32_t getPixelColor(uint16_t n) const;
+    void clear();
+    void show();
+    boolean blocksInterrupts() const { return bitBanged; }
+
+    const uint8_t* getPixels() const { return pixels; }
+    unsigned long frames = 0;
+    boolean bitBanged = false; // stands in for a strip that does
+    uint32_t hash = 2166136261UL;
+
+  private:
+    uint16_t numLEDs;
+    uint8_t brightness = 255;
+    uint8_t* pixels;
+    FILE* out;
+};
+
+#endif // __RECORDINGSINK_H__
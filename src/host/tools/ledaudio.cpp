@@ -0,0 +1,111 @@
+// Runs an audio effect on the music of a WAV file (16 bit PCM) in place of
+// the microphone, and times the analysis.
+//
+//   ledaudio [--async] file.wav [effect] [leds] [out.ppm]
+//
+// effect defaults to AUDIO_SPECTRUM. First every block of the file is
+// analyzed on its own to time the FFT and band/beat stage per block; the
+// latency from a sound to the bands is one block of samples plus that.
+// Then the effect runs against the virtual clock for the length of the
+// file, frames go to out.ppm like with ledsim, and the blocks, skipped
+// samples, restarted blocks and beats Audio saw are reported.
+//
+// The clock moves like on the controller: the sampling timer fires every
+// period while a loop takes LEDAUDIO_LOOP_US, and every frame shown takes
+// LEDAUDIO_LED_US per LED. Bit-banged (the default) the interrupts are off
+// for that long, so the timer fires once, late, when it is over; --async
+// sends in the background like the sinks in asyncsink.h.
+
+#include <chrono>
+#include <stdio.h>
+#include "led.h"
+#include "recordingsink.h"
+#include "wavsource.h"
+
+#define LEDAUDIO_LOOP_US 250
+#define LEDAUDIO_LED_US   30 // 24 bits at 800 kHz
+
+int main(int argc, char** argv) {
+  boolean async = argc > 1 && strcmp(argv[1], "--async") == 0;
+  if(async) {
+    argc--;
+    argv++;
+  }
+  if(argc < 2) {
+    fprintf(stderr, "usage: ledaudio [--async] file.wav [effect] [leds] [out.ppm]\n");
+    return 1;
+  }
+  int effect      = argc > 2 ? atoi(argv[2]) : AUDIO_SPECTRUM;
+  int leds        = argc > 3 ? atoi(argv[3]) : 100;
+  const char* out = argc > 4 ? argv[4] : nullptr;
+
+  WavSource wav;
+  if(!wav.load(argv[1])) {
+    fprintf(stderr, "%s: not a 16 bit PCM WAV file\n", argv[1]);
+    return 1;
+  }
+
+  // Analysis cost per block, on the file taken at AUDIO_RATE
+  Audio bench(wav);
+  std::vector<int> block(AUDIO_SAMPLES);
+  std::chrono::nanoseconds busy(0);
+  unsigned long total = (unsigned long) (wav.seconds() * AUDIO_RATE);
+  for(unsigned long at = 0; at + AUDIO_SAMPLES <= total; at += AUDIO_SAMPLES) {
+    for(int i = 0; i < AUDIO_SAMPLES; i++) {
+      block[i] = 512 + (wav.pcm[(at + i) * wav.rate / AUDIO_RATE] >> 6);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    bench.analyze(&block[0]);
+    busy += std::chrono::steady_clock::now() - t0;
+  }
+  double ns = bench.blocks ? (double) busy.count() / bench.blocks : 0;
+  double blockMs = 1000.0 * AUDIO_SAMPLES / AUDIO_RATE;
+  fprintf(stderr, "%lu blocks of %.1f ms, %.0f ns/block analysis, latency %.2f ms, %lu beats\n",
+          bench.blocks, blockMs, ns, blockMs + ns / 1e6, bench.beats());
+
+  FILE* file = nullptr;
+  if(out != nullptr) {
+    file = strcmp(out, "-") == 0 ? stdout : fopen(out, "wb");
+    if(file == nullptr) {
+      perror(out);
+      return 1;
+    }
+  }
+  RecordingSink sink(leds, file);
+  sink.bitBanged = !async;
+  LED led(&sink);
+  led.setDisplay(false); // no Nextion on the host
+  Audio audio(wav);
+  led.setAudio(&audio);
+  led.setEffect(effect);
+  wav.start = micros();
+  const unsigned long period = 1000000UL / AUDIO_RATE;
+  unsigned long nextSample = wav.start;
+  while(micros() - wav.start < (unsigned long) (wav.seconds() * 1e6)) {
+    unsigned long shown = sink.frames;
+    led.loop();
+    const boolean blocked = !async && sink.frames != shown;
+    const unsigned long start = micros();
+    const unsigned long busy = blocked ? leds * LEDAUDIO_LED_US : LEDAUDIO_LOOP_US;
+    boolean pending = false;
+    for(; (long)(start + busy - nextSample) >= 0; nextSample += period) {
+      if(blocked) {
+        pending = true;
+        continue;
+      }
+      hostAdvanceMicros(nextSample - micros());
+      audio.sample(micros());
+    }
+    hostAdvanceMicros(start + busy - micros());
+    if(pending) {
+      audio.sample(micros());
+    }
+  }
+  if(file != nullptr && file != stdout) {
+    fclose(file);
+  }
+  fprintf(stderr, "%s: %lu frames, %lu blocks, %lu samples skipped, %lu blocks restarted, "
+          "%lu beats, hash %08x\n", LED::effectName(effect), sink.frames, audio.blocks,
+          (unsigned long) audio.dropped, audio.restarts, audio.beats(), (unsigned) sink.hash);
+  return 0;
+}
@@ -0,0 +1,190 @@
+// Regression suite for the effects: times one frame of every effect at a
+// time, without any pacing delays, against a sink that drops the frames,
+// and checks that they still render the same frames.
+//
+//   ledbench [--update] golden.txt [frames] [slowdown]
+//
+// For each strip length it reports ns per rendered frame (the best of a
+// few runs), ns per pixel, the frame rate the host could sustain and the
+// ms per frame on the board, the host time multiplied by 'slowdown' (the
+// measured ratio between the target board and this machine).
+// "misses 60 fps" marks effects whose board time is over the 60 fps frame
+// budget (16.7 ms); that is a report, it does not fail the suite.
+//
+// What fails it: "over" marks effects slower than their budget in
+// LED_EFFECT_LIST, counted in steps of a calibration loop timed in the same
+// run, so the budgets hold on a slower or busier machine as well.
+// "changed" marks effects whose frames no longer hash to the value in
+// golden.txt (all random numbers come from LED_SEED, so they are the same
+// on every run). The exit status is 1 if any effect is over budget or
+// changed, e.g. to check an optimization before it goes onto the
+// controllers. A missing golden.txt is an error as well; --update writes
+// it from the frames rendered now.
+//
+// The golden file for this tree is src/host/tools/ledbench.txt.
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <stdio.h>
+#include "led.h"
+#include "nullsink.h"
+#include "recordingsink.h"
+
+static const int lengths[] = { 100, 300, 1000, 5000 };
+
+// Frames hashed per effect and length, independent of the frames timed
+#define LEDBENCH_HASH_FRAMES 300
+// Timed runs per effect and length
+#define LEDBENCH_RUNS 3
+
+// ESP8266 at 80 MHz against a desktop machine, roughly
+#define LEDBENCH_SLOWDOWN 40
+
+// Budget of every frame regardless of its length, in calibration steps
+#define LEDBENCH_FRAME_STEPS 1500
+
+// Budgets per LED by effect number, from LED_EFFECT_LIST
+#define LEDBENCH_BUDGET(id, name, frame, rotation, overlay, colors, budget) budget,
+static const int budgets[] = {
+  LED_EFFECT_LIST(LEDBENCH_BUDGET)
+};
+#undef LEDBENCH_BUDGET
+
+// ns per step of a loop of byte arithmetic, each step depending on the
+// last, about what an effect does per channel. The fastest of a few runs.
+static double calibrate() {
+  static uint8_t buffer[3000];
+  const int passes = 2000;
+  double best = 0;
+  for(int run = 0; run < LEDBENCH_RUNS; run++) {
+    uint32_t seed = run;
+    auto t0 = std::chrono::steady_clock::now();
+    for(int p = 0; p < passes; p++) {
+      for(int i = 0; i < (int) sizeof(buffer); i++) {
+        seed = seed * 1664525 + 1013904223;
+        buffer[i] = (buffer[i] * 200 + (seed >> 24) * 56) >> 8;
+      }
+    }
+    double ns = (double) std::chrono::nanoseconds(std::chrono::steady_clock::now() - t0).count() /
+                passes / sizeof(buffer);
+    if(run == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  volatile uint8_t keep = buffer[0]; // the loop must not be optimized away
+  (void) keep;
+  return best;
+}
+
+// Hash over the first frames of an effect
+static uint32_t frameHash(int effect, int leds) {
+  RecordingSink sink(leds);
+  LED led(&sink);
+  led.setEffect(effect);
+  led.setTargetFps(0);
+  unsigned long now = millis();
+  for(long f = 0; f < LEDBENCH_HASH_FRAMES; f++) {
+    now += 100000;
+    led.step(now);
+  }
+  return sink.hash;
+}
+
+int main(int argc, char** argv) {
+  boolean update = argc > 1 && strcmp(argv[1], "--update") == 0;
+  if(update) {
+    argc--;
+    argv++;
+  }
+  if(argc < 2) {
+    fprintf(stderr, "usage: ledbench [--update] golden.txt [frames] [slowdown]\n");
+    return 1;
+  }
+  const char* golden = argv[1];
+  long frames = argc > 2 ? atol(argv[2]) : 500;
+  double slowdown = argc > 3 ? atof(argv[3]) : LEDBENCH_SLOWDOWN;
+
+  // Stored hashes by "effect leds"
+  std::map<std::string, uint32_t> hashes;
+  FILE* record = nullptr;
+  if(update) {
+    if((record = fopen(golden, "w")) == nullptr) {
+      perror(golden);
+      return 1;
+    }
+  }
+  else {
+    FILE* in = fopen(golden, "r");
+    if(in == nullptr) {
+      perror(golden);
+      fprintf(stderr, "run with --update to write it\n");
+      return 1;
+    }
+    char name[64];
+    int leds;
+    unsigned hash;
+    while(fscanf(in, "%63s %d %x", name, &leds, &hash) == 3) {
+      hashes[std::string(name) + " " + std::to_string(leds)] = hash;
+    }
+    fclose(in);
+  }
+  boolean failed = false;
+
+  const double step = calibrate();
+  printf("calibration %.2f ns per step, board %.0fx slower\n", step, slowdown);
+  printf("%-20s %6s %12s %10s %10s %10s\n", "effect", "leds", "ns/frame", "ns/pixel", "max fps", "board ms");
+  for(int e = 0; e < LED::numEffects; e++) {
+    const char* name = LED::effectName(e);
+    for(int leds : lengths) {
+      // The fastest of a few runs, so a busy machine doesn't fail an effect
+      double ns = 0;
+      unsigned long rendered = 0;
+      for(int run = 0; run < LEDBENCH_RUNS; run++) {
+        NullSink sink(leds);
+        LED led(&sink);
+        led.setEffect(e);
+        led.setTargetFps(0);
+
+        // Every call gets a time far enough ahead that its frame is due
+        unsigned long now = millis();
+        std::chrono::nanoseconds busy(0);
+        for(long f = 0; f < frames; f++) {
+          now += 100000;
+          auto t0 = std::chrono::steady_clock::now();
+          led.step(now);
+          busy += std::chrono::steady_clock::now() - t0;
+        }
+        rendered = led.frames;
+        if(rendered > 0 && (run == 0 || (double) busy.count() / rendered < ns)) {
+          ns = (double) busy.count() / rendered;
+        }
+      }
+      if(rendered == 0) {
+        printf("%-20s %6d nothing rendered\n", name, leds);
+        failed = true;
+        continue;
+      }
+
+      boolean over = ns > (budgets[e] * leds + LEDBENCH_FRAME_STEPS) * step;
+      double board = ns * slowdown / 1e6;
+      boolean changed = false;
+      uint32_t hash = frameHash(e, leds);
+      if(record != nullptr) {
+        fprintf(record, "%s %d %08x\n", name, leds, (unsigned) hash);
+      }
+      else {
+        std::string key = std::string(name) + " " + std::to_string(leds);
+        changed = hashes.count(key) == 0 || hashes[key] != hash;
+      }
+      failed |= over || changed;
+      printf("%-20s %6d %12.0f %10.2f %10.0f %10.2f%s%s%s\n", name, leds, ns, ns / leds,
+             1e9 / ns, board, board > 1000.0 / 60 ? "  misses 60 fps" : "",
+             over ? "  over" : "", changed ? "  changed" : "");
+    }
+  }
+  if(record != nullptr) {
+    fclose(record);
+  }
+  return failed ? 1 : 0;
+}
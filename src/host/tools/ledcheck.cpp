@@ -0,0 +1,105 @@
+// Checks parts of the controller on their own, against results worked out
+// by hand. Prints every check that fails; the exit status is 1 if any did.
+//
+//   ledcheck
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "framestats.h"
+#include "led.h"
+#include "recordingsink.h"
+
+static int failures = 0;
+
+static void check(boolean ok, const char* what) {
+  if(!ok) {
+    printf("failed: %s\n", what);
+    failures++;
+  }
+}
+
+// Frames within the histogram report their bucket, longer ones the
+// longest frame rather than the end of the histogram
+static void checkFrameStats() {
+  FrameStats stats;
+  for(int i = 0; i < 100; i++) {
+    stats.add(1000);
+  }
+  check(stats.percentile(99) == 4 * FRAMESTATS_BUCKET_US, "percentile within the buckets");
+
+  const unsigned long range = FRAMESTATS_BUCKETS * FRAMESTATS_BUCKET_US;
+  stats.reset();
+  for(int i = 0; i < 100; i++) {
+    stats.add(range + 10000 + i * 100);
+  }
+  check(stats.maximum() == range + 19900, "longest frame past the buckets");
+  check(stats.percentile(99) == stats.maximum(), "percentile past the buckets is the longest frame");
+  check(stats.percentile(50) >= stats.mean() - 5000, "median past the buckets not capped");
+}
+
+// Input that sets every LED to one color, once
+class SolidInput : public PixelInput {
+
+  public:
+    SolidInput(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+
+    boolean poll(uint8_t* pixels, int count, int& from, int& to) {
+      if(sent) {
+        return false;
+      }
+      for(int i = 0; i < count; i++) {
+        pixels[i * 3] = r;
+        pixels[i * 3 + 1] = g;
+        pixels[i * 3 + 2] = b;
+      }
+      from = 0;
+      to = count;
+      sent = true;
+      return true;
+    }
+
+  private:
+    uint8_t r, g, b;
+    boolean sent = false;
+};
+
+// First LED shown with one layer over the color 100,40,200
+static uint32_t blended(int effect, LED::BlendMode mode, byte alpha) {
+  RecordingSink sink(10);
+  LED led(&sink);
+  SolidInput input(100, 40, 200);
+  led.setInput(&input);
+  led.setTransition(0);
+  led.setEffect(STREAM_INPUT);
+  led.setBrightness(255);
+  led.setDithering(false);
+  led.setTargetFps(0);
+  led.addLayer(effect, mode, alpha);
+  led.step(millis());
+  return sink.getPixelColor(0);
+}
+
+static boolean near(uint32_t color, int r, int g, int b) {
+  return abs((int) ((color >> 16) & 0xff) - r) <= 1 &&
+         abs((int) ((color >> 8) & 0xff) - g) <= 1 &&
+         abs((int) (color & 0xff) - b) <= 1;
+}
+
+// A layer at alpha 0 leaves the pixels below as they are and one at 128
+// goes about half way to the blend, in every mode. STROBE starts with
+// a white frame, STREAM_INPUT as a layer stays black.
+static void checkBlendAlpha() {
+  check(near(blended(STROBE, LED::BLEND_MAX, 0), 100, 40, 200), "max layer at alpha 0");
+  check(near(blended(STROBE, LED::BLEND_MAX, 128), 178, 148, 228), "max layer at alpha 128");
+  check(near(blended(STREAM_INPUT, LED::BLEND_MULTIPLY, 0), 100, 40, 200), "multiply layer at alpha 0");
+  check(near(blended(STREAM_INPUT, LED::BLEND_MULTIPLY, 128), 50, 20, 100), "multiply layer at alpha 128");
+  check(near(blended(STROBE, LED::BLEND_ALPHA, 0), 100, 40, 200), "alpha layer at alpha 0");
+  check(near(blended(STROBE, LED::BLEND_ADD, 0), 100, 40, 200), "add layer at alpha 0");
+}
+
+int main() {
+  checkFrameStats();
+  checkBlendAlpha();
+  printf("%s\n", failures ? "failed" : "ok");
+  return failures ? 1 : 0;
+}
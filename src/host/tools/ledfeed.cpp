@@ -0,0 +1,154 @@
+// Streams Adalight frames through a pipe into LED running the STREAM_INPUT
+// effect, like a PC feeding the controller over the serial line, and
+// measures how long a frame takes from being sent to being shown.
+//
+//   ledfeed [frames] [leds] [fps]
+//
+// A second thread writes the frames (fps 0: as fast as the pipe takes
+// them). Pixel 0 carries the frame number and pixel 1 its complement, so
+// the shown frames can be matched to the sent ones. The virtual clock
+// follows the real one here. Reports the frames and bytes per second that
+// made it to the strip and the send to show latency.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "led.h"
+#include "recordingsink.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static long long nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// Non-blocking read end of the pipe
+class PipeStream : public Stream {
+
+  public:
+    PipeStream(int fd) : fd(fd) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    int available() {
+      if(head == tail) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        head = 0;
+        tail = n > 0 ? n : 0;
+        eof = n == 0;
+      }
+      return tail - head;
+    }
+    int read() { return available() > 0 ? buffer[head++] : -1; }
+    size_t write(uint8_t c) { return 0; }
+
+    boolean eof = false;
+
+  private:
+    int fd;
+    uint8_t buffer[4096];
+    int head = 0, tail = 0;
+};
+
+int main(int argc, char** argv) {
+  long frames = argc > 1 ? atol(argv[1]) : 2000;
+  int leds    = argc > 2 ? atoi(argv[2]) : 300;
+  int fps     = argc > 3 ? atoi(argv[3]) : 0;
+
+  int fds[2];
+  if(pipe(fds) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  PipeStream in(fds[0]);
+  AdalightInput adalight(in);
+  RecordingSink sink(leds);
+  LED led(&sink);
+  led.setDisplay(false); // no Nextion on the host
+  led.setInput(&adalight);
+  led.setEffect(STREAM_INPUT);
+  led.setBrightness(255); // the frame numbers reach the sink unscaled
+  // Let the crossfade into STREAM_INPUT finish first
+  for(int ms = 0; ms < LED_TRANSITION_MS + 100; ms++) {
+    led.loop();
+    hostAdvanceMicros(1000);
+  }
+
+  std::unique_ptr<std::atomic<long long>[]> sent(new std::atomic<long long>[frames]);
+  long long begin = nowMicros();
+  std::thread writer([&]() {
+    std::vector<uint8_t> msg(6 + leds * 3);
+    int n = leds - 1;
+    msg[0] = 'A'; msg[1] = 'd'; msg[2] = 'a';
+    msg[3] = n >> 8; msg[4] = n; msg[5] = msg[3] ^ msg[4] ^ 0x55;
+    Clock::time_point next = Clock::now();
+    for(long f = 0; f < frames; f++) {
+      uint8_t* p = &msg[6];
+      for(int i = 0; i < leds * 3; i++) {
+        p[i] = f + i;
+      }
+      p[0] = f >> 16; p[1] = f >> 8; p[2] = f;
+      p[3] = ~p[0];   p[4] = ~p[1];  p[5] = ~p[2];
+      sent[f] = nowMicros();
+      for(size_t done = 0; done < msg.size(); ) {
+        ssize_t w = write(fds[1], &msg[done], msg.size() - done);
+        if(w <= 0) {
+          return;
+        }
+        done += w;
+      }
+      if(fps > 0) {
+        next += std::chrono::microseconds(1000000 / fps);
+        std::this_thread::sleep_until(next);
+      }
+    }
+    close(fds[1]);
+  });
+
+  std::vector<long long> latency;
+  unsigned long shown = sink.frames;
+  long last = -1;
+  long long clock = nowMicros();
+  while(!in.eof) {
+    led.loop();
+    long long t = nowMicros();
+    hostAdvanceMicros(t - clock);
+    clock = t;
+    if(sink.frames == shown) {
+      continue;
+    }
+    shown = sink.frames;
+    const uint8_t* p = sink.getPixels();
+    long f = ((long) p[0] << 16) | (p[1] << 8) | p[2];
+    if(leds < 2 || (p[3] ^ p[0]) != 0xff || (p[4] ^ p[1]) != 0xff || (p[5] ^ p[2]) != 0xff ||
+       f <= last || f >= frames) {
+      continue;
+    }
+    latency.push_back(t - sent[f]);
+    last = f;
+  }
+  writer.join();
+  double seconds = (nowMicros() - begin) / 1e6;
+
+  std::sort(latency.begin(), latency.end());
+  long long sum = 0;
+  for(long long l : latency) {
+    sum += l;
+  }
+  size_t count = latency.size();
+  fprintf(stderr, "%lu of %ld frames shown, %lu received, %lu header errors\n",
+          (unsigned long) count, frames, adalight.frames, adalight.errors);
+  fprintf(stderr, "%.1f frames/s, %.1f KB/s\n",
+          count / seconds, adalight.frames * (6.0 + leds * 3) / seconds / 1024);
+  if(count > 0) {
+    fprintf(stderr, "latency %lld/%lld/%lld us (mean/p99/max)\n",
+            sum / (long long) count, latency[count * 99 / 100], latency[count - 1]);
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+// Checks the power limiter: what it costs per frame has to follow the
+// pixels that changed, not the length of the strip, and the running sum
+// its estimate is based on has to match the levels sent.
+//
+//   ledpower [commits] [frames]
+//
+// One pixel is streamed in and shown 'commits' times, on a strip of 300
+// and one of 3000 LEDs with the power budget on, and the time per commit
+// is compared. Then every effect renders 'frames' frames under a budget
+// tight enough to dim them, and the sum is counted again. The exit status
+// is 1 if the longer strip takes more than LEDPOWER_MAX_RATIO times as long
+// per commit or a sum is off.
+
+#include <chrono>
+#include <stdio.h>
+#include "led.h"
+#include "nullsink.h"
+
+#define LEDPOWER_MAX_RATIO 2.0
+// Timed runs per length, the fastest counts
+#define LEDPOWER_RUNS 3
+
+// Input that changes one pixel per poll, walking along the strip
+class OnePixel : public PixelInput {
+
+  public:
+    boolean poll(uint8_t* pixels, int count, int& from, int& to) {
+      int i = polls++ % count;
+      uint8_t* p = &pixels[i * 3];
+      p[0] = polls;
+      p[1] = polls >> 4;
+      p[2] = ~polls;
+      from = i;
+      to = i + 1;
+      return true;
+    }
+
+    unsigned long polls = 0;
+};
+
+// ns per commit of one changed pixel on a strip of 'leds'
+static double commitCost(int leds, long commits, boolean& loadOk) {
+  double best = 0;
+  for(int run = 0; run < LEDPOWER_RUNS; run++) {
+    NullSink sink(leds);
+    LED led(&sink);
+    OnePixel input;
+    led.setInput(&input);
+    led.setTransition(0); // a crossfade redraws every LED
+    led.setEffect(STREAM_INPUT);
+    led.setPowerBudget(1000000); // on, but never dims: that scales all LEDs
+    led.setDithering(false); // its refreshes walk the strip on purpose
+    led.setTargetFps(0);
+
+    // The effect's own frames are done after the first step, from then on
+    // every step is a poll of the input and its commit
+    unsigned long now = millis();
+    led.step(now);
+    auto t0 = std::chrono::steady_clock::now();
+    for(long c = 0; c < commits; c++) {
+      led.step(now);
+    }
+    double ns = (double) std::chrono::nanoseconds(std::chrono::steady_clock::now() - t0).count() / commits;
+    if(run == 0 || ns < best) {
+      best = ns;
+    }
+    loadOk &= led.checkLoad();
+  }
+  return best;
+}
+
+int main(int argc, char** argv) {
+  long commits = argc > 1 ? atol(argv[1]) : 1000000;
+  long frames  = argc > 2 ? atol(argv[2]) : 300;
+  boolean failed = false;
+
+  boolean loadOk = true;
+  double shortStrip = commitCost(300, commits, loadOk);
+  double longStrip = commitCost(3000, commits, loadOk);
+  boolean slow = longStrip > shortStrip * LEDPOWER_MAX_RATIO;
+  printf("one pixel per commit: %.0f ns at 300 LEDs, %.0f ns at 3000 LEDs%s\n",
+         shortStrip, longStrip, slow ? "  grows with the strip" : "");
+  if(!loadOk) {
+    printf("one pixel per commit: sum of the levels off\n");
+  }
+  failed |= slow || !loadOk;
+
+  for(int e = 0; e < LED::numEffects; e++) {
+    NullSink sink(300);
+    LED led(&sink);
+    led.setEffect(e);
+    led.setTargetFps(0);
+    led.setBrightness(255);
+    led.setPowerBudget(2000);
+    unsigned long now = millis();
+    boolean ok = true;
+    for(long f = 0; f < frames; f++) {
+      now += 100000;
+      led.step(now);
+      ok &= led.checkLoad();
+    }
+    if(!ok) {
+      printf("%s: sum of the levels off\n", LED::effectName(e));
+      failed = true;
+    }
+  }
+  printf("%s\n", failed ? "failed" : "ok");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,314 @@
+// Compiles a show from text into the program format Sequence plays (see
+// sequence.h) and times the player.
+//
+//   ledseq compile show.txt [show.h] [name]
+//   ledseq bench show.txt [leds] [seconds]
+//
+// compile writes a header with the program as a PROGMEM array ('name',
+// by default the file name) to show.h or stdout, one command per line with
+// its source as a comment. The text has one command per line, # starts a
+// comment, effects are given by name or number (colors only for those
+// that draw in them, see LED::takesColors()):
+//
+//   effect <effect> [red green blue]
+//   layer <effect> alpha|add|max|multiply [alpha]
+//   clear layers
+//   wait <ms>
+//   brightness <level> [over <ms>]
+//   velocity <ms>
+//   transition <ms>
+//   loop
+//   end
+//
+// bench plays the show on a strip that drops the frames, against the
+// virtual clock with the show attached to LED as on the controller, and
+// reports the time spent in Sequence::run() next to what LED::loop()
+// takes, the player included.
+
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "led.h"
+#include "nullsink.h"
+
+struct Command {
+  std::vector<uint8_t> code;
+  std::string source;
+};
+
+static int findEffect(const std::string& word) {
+  for(int e = 0; e < LED::numEffects; e++) {
+    if(word == LED::effectName(e)) {
+      return e;
+    }
+  }
+  char* end;
+  long e = strtol(word.c_str(), &end, 10);
+  return *end == 0 && !word.empty() && e >= 0 && e < LED::numEffects ? e : -1;
+}
+
+static bool number(const std::string& word, long lo, long hi, long& value) {
+  char* end;
+  value = strtol(word.c_str(), &end, 10);
+  return *end == 0 && !word.empty() && value >= lo && value <= hi;
+}
+
+static void put16(std::vector<uint8_t>& code, long value) {
+  code.push_back(value);
+  code.push_back(value >> 8);
+}
+
+// Parse one line into 'command'. Returns an error message, or nullptr.
+static const char* parse(const std::vector<std::string>& w, Command& command) {
+  std::vector<uint8_t>& code = command.code;
+  const std::string& op = w[0];
+  long a, b, c;
+  if(op == "effect" && (w.size() == 2 || w.size() == 5)) {
+    int effect = findEffect(w[1]);
+    if(effect < 0) {
+      return "unknown effect";
+    }
+    if(w.size() == 2) {
+      code = { SEQ_EFFECT, (uint8_t) effect };
+      return nullptr;
+    }
+    if(!LED::takesColors(effect)) {
+      return "the effect has colors of its own";
+    }
+    if(!number(w[2], 0, 255, a) || !number(w[3], 0, 255, b) || !number(w[4], 0, 255, c)) {
+      return "colors are 0 to 255";
+    }
+    code = { SEQ_EFFECT_COLOR, (uint8_t) effect, (uint8_t) a, (uint8_t) b, (uint8_t) c };
+    return nullptr;
+  }
+  if(op == "layer" && (w.size() == 3 || w.size() == 4)) {
+    static const char* modes[] = { "alpha", "add", "max", "multiply" };
+    int effect = findEffect(w[1]);
+    int mode = -1;
+    for(int m = 0; m < 4; m++) {
+      if(w[2] == modes[m]) {
+        mode = m;
+      }
+    }
+    a = 255;
+    if(effect < 0 || mode < 0 || (w.size() == 4 && !number(w[3], 0, 255, a))) {
+      return "layer <effect> alpha|add|max|multiply [0-255]";
+    }
+    code = { SEQ_LAYER, (uint8_t) effect, (uint8_t) mode, (uint8_t) a };
+    return nullptr;
+  }
+  if(op == "clear" && w.size() == 2 && w[1] == "layers") {
+    code = { SEQ_CLEAR_LAYERS };
+    return nullptr;
+  }
+  if(op == "wait" && w.size() == 2) {
+    if(!number(w[1], 0, 0x7fffffffL, a)) {
+      return "wait <ms>";
+    }
+    // Longer than 16 bits: several waits
+    do {
+      code.push_back(SEQ_WAIT);
+      put16(code, min(a, 65535L));
+      a -= min(a, 65535L);
+    } while(a > 0);
+    return nullptr;
+  }
+  if(op == "brightness" && (w.size() == 2 || (w.size() == 4 && w[2] == "over"))) {
+    b = 0;
+    if(!number(w[1], 0, 255, a) || (w.size() == 4 && !number(w[3], 0, 65535, b))) {
+      return "brightness <0-255> [over <ms up to 65535>]";
+    }
+    code = { SEQ_BRIGHTNESS, (uint8_t) a };
+    put16(code, b);
+    return nullptr;
+  }
+  if(op == "velocity" && w.size() == 2) {
+    if(!number(w[1], 0, 255, a)) {
+      return "velocity <0-255>";
+    }
+    code = { SEQ_VELOCITY, (uint8_t) a };
+    return nullptr;
+  }
+  if(op == "transition" && w.size() == 2) {
+    if(!number(w[1], 0, 65535, a)) {
+      return "transition <ms up to 65535>";
+    }
+    code = { SEQ_TRANSITION };
+    put16(code, a);
+    return nullptr;
+  }
+  if(op == "loop" && w.size() == 1) {
+    code = { SEQ_LOOP };
+    return nullptr;
+  }
+  if(op == "end" && w.size() == 1) {
+    code = { SEQ_END };
+    return nullptr;
+  }
+  return "unknown command";
+}
+
+static bool compile(const char* path, std::vector<Command>& commands) {
+  FILE* in = fopen(path, "r");
+  if(in == nullptr) {
+    perror(path);
+    return false;
+  }
+  bool ok = true;
+  char line[256];
+  for(int n = 1; fgets(line, sizeof(line), in) != nullptr; n++) {
+    std::string text(line, strcspn(line, "#\r\n"));
+    std::vector<std::string> words;
+    for(size_t i = 0; i < text.size(); ) {
+      while(i < text.size() && isspace((unsigned char) text[i])) {
+        i++;
+      }
+      size_t start = i;
+      while(i < text.size() && !isspace((unsigned char) text[i])) {
+        i++;
+      }
+      if(i > start) {
+        words.push_back(text.substr(start, i - start));
+      }
+    }
+    if(words.empty()) {
+      continue;
+    }
+    Command command;
+    command.source = text.substr(text.find_first_not_of(" \t"));
+    command.source.erase(command.source.find_last_not_of(" \t") + 1);
+    const char* error = parse(words, command);
+    if(error != nullptr) {
+      fprintf(stderr, "%s:%d: %s\n", path, n, error);
+      ok = false;
+      continue;
+    }
+    commands.push_back(command);
+  }
+  fclose(in);
+  if(commands.empty() || (commands.back().code[0] != SEQ_LOOP && commands.back().code[0] != SEQ_END)) {
+    Command end;
+    end.code = { SEQ_END };
+    end.source = "end";
+    commands.push_back(end);
+  }
+  return ok;
+}
+
+static std::vector<uint8_t> program(const std::vector<Command>& commands) {
+  std::vector<uint8_t> bytes = { 'L', 'S', SEQ_VERSION };
+  for(const Command& command : commands) {
+    bytes.insert(bytes.end(), command.code.begin(), command.code.end());
+  }
+  return bytes;
+}
+
+static int writeHeader(const char* path, const char* out, std::string name,
+                       const std::vector<Command>& commands) {
+  if(name.empty()) {
+    const char* base = strrchr(path, '/');
+    name = base != nullptr ? base + 1 : path;
+    name = name.substr(0, name.find('.'));
+  }
+  for(char& c : name) {
+    if(!isalnum((unsigned char) c)) {
+      c = '_';
+    }
+  }
+  std::string guard = "__" + name + "_H__";
+  for(char& c : guard) {
+    c = toupper((unsigned char) c);
+  }
+  FILE* file = out != nullptr ? fopen(out, "w") : stdout;
+  if(file == nullptr) {
+    perror(out);
+    return 1;
+  }
+  size_t size = 3;
+  for(const Command& command : commands) {
+    size += command.code.size();
+  }
+  fprintf(file, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+  fprintf(file, "// Generated by ledseq from %s, %lu bytes\n\n", path, (unsigned long) size);
+  fprintf(file, "#include <Arduino.h>\n\n");
+  fprintf(file, "const uint8_t %s[] PROGMEM = {\n", name.c_str());
+  fprintf(file, "  'L', 'S', %d,\n", SEQ_VERSION);
+  for(const Command& command : commands) {
+    std::string bytes;
+    char hex[8];
+    for(uint8_t b : command.code) {
+      snprintf(hex, sizeof(hex), "0x%02x, ", b);
+      bytes += hex;
+    }
+    fprintf(file, "  %-30s// %s\n", bytes.c_str(), command.source.c_str());
+  }
+  fprintf(file, "};\n\n#endif // %s\n", guard.c_str());
+  if(file != stdout) {
+    fclose(file);
+  }
+  return 0;
+}
+
+static int bench(const std::vector<uint8_t>& bytes, int leds, long seconds) {
+  typedef std::chrono::steady_clock Clock;
+  NullSink sink(leds);
+  LED led(&sink);
+  led.setDisplay(false); // no Nextion on the host
+  Sequence sequence(&bytes[0]);
+  led.setSequence(&sequence); // starts it, and the effect rotation stays off
+
+  // The player is timed on its own on a copy of the show, driving an LED
+  // that never renders, so its calls cost what they cost in LED::loop()
+  NullSink idleSink(leds);
+  LED idle(&idleSink);
+  Sequence player(&bytes[0]);
+  player.start(millis());
+
+  // What reading the clock costs, taken off both times below
+  const int samples = 1000000;
+  auto c0 = Clock::now();
+  for(int i = 0; i < samples; i++) {
+    Clock::now();
+  }
+  double clock = (double) std::chrono::nanoseconds(Clock::now() - c0).count() / samples;
+
+  std::chrono::nanoseconds playing(0), frames(0);
+  unsigned long calls = 0;
+  unsigned long start = millis();
+  while(millis() - start < (unsigned long) seconds * 1000) {
+    auto t0 = Clock::now();
+    player.run(idle, millis());
+    auto t1 = Clock::now();
+    led.loop();
+    auto t2 = Clock::now();
+    playing += t1 - t0;
+    frames += t2 - t1;
+    calls++;
+    hostAdvanceMicros(1000);
+  }
+  double perCall = max(0.0, (double) playing.count() / calls - clock);
+  double perLoop = max(1.0, (double) frames.count() / calls - clock);
+  fprintf(stderr, "%lu bytes, %lu commands in %ld s, %lu frames of %d LEDs\n",
+          (unsigned long) bytes.size(), sequence.commands, seconds, sink.frames, leds);
+  fprintf(stderr, "player %.1f ns per call, LED::loop() %.0f ns per call (%.2f%%)\n",
+          perCall, perLoop, 100.0 * perCall / perLoop);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if(argc < 3 || (strcmp(argv[1], "compile") != 0 && strcmp(argv[1], "bench") != 0)) {
+    fprintf(stderr, "usage: ledseq compile show.txt [show.h] [name]\n"
+                    "       ledseq bench show.txt [leds] [seconds]\n");
+    return 1;
+  }
+  std::vector<Command> commands;
+  if(!compile(argv[2], commands)) {
+    return 1;
+  }
+  if(strcmp(argv[1], "compile") == 0) {
+    return writeHeader(argv[2], argc > 3 ? argv[3] : nullptr, argc > 4 ? argv[4] : "", commands);
+  }
+  return bench(program(commands), argc > 3 ? atoi(argv[3]) : 300, argc > 4 ? atol(argv[4]) : 60);
+}
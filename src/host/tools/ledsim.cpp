@@ -0,0 +1,70 @@
+// Runs the LED effects natively against a virtual clock and records every
+// frame the strip would show.
+//
+//   ledsim [effect] [leds] [seconds] [out.ppm] [sync|async]
+//
+// effect -1 keeps the normal effect rotation. The frames go to out.ppm as a
+// stream of PPM images ("-" for stdout, e.g. into ffmpeg -f image2pipe).
+// Frames per second, render cost per frame and a hash over all frames are
+// reported on stderr; equal hashes mean bit identical output. The frame
+// time statistics kept by LED itself follow (in virtual time).
+//
+// sync/async also take the time the strip needs to receive each frame:
+// sync blocks in show() like Adafruit_NeoPixel, async sends in the
+// background like the NeoPixelBus UART/DMA methods. The time LED had to
+// wait for the strip is reported with them. Use "" as out.ppm to record
+// nothing.
+
+#include <chrono>
+#include <stdio.h>
+#include "led.h"
+#include "recordingsink.h"
+#include "wiresink.h"
+
+int main(int argc, char** argv) {
+  int effect      = argc > 1 ? atoi(argv[1]) : -1;
+  int leds        = argc > 2 ? atoi(argv[2]) : 100;
+  long seconds    = argc > 3 ? atol(argv[3]) : 15;
+  const char* out = argc > 4 && *argv[4] ? argv[4] : nullptr;
+  const char* wire = argc > 5 ? argv[5] : nullptr;
+
+  FILE* file = nullptr;
+  if(out != nullptr) {
+    file = strcmp(out, "-") == 0 ? stdout : fopen(out, "wb");
+    if(file == nullptr) {
+      perror(out);
+      return 1;
+    }
+  }
+
+  RecordingSink plain(leds, file);
+  WireSink timed(leds, wire != nullptr && strcmp(wire, "async") == 0, file);
+  RecordingSink& sink = wire != nullptr ? timed : plain;
+  LED led(&sink);
+  led.setDisplay(false); // no Nextion on the host
+  if(effect >= 0) {
+    led.setEffect(effect);
+  }
+
+  std::chrono::nanoseconds busy(0);
+  unsigned long start = millis();
+  while(millis() - start < (unsigned long) seconds * 1000) {
+    auto t0 = std::chrono::steady_clock::now();
+    led.loop();
+    busy += std::chrono::steady_clock::now() - t0;
+    hostAdvanceMicros(1000);
+  }
+
+  if(file != nullptr && file != stdout) {
+    fclose(file);
+  }
+  double ns = sink.frames ? (double) busy.count() / sink.frames : 0;
+  fprintf(stderr, "frames %lu, %.1f fps, %.0f ns/frame, %.2f ns/pixel, hash %08x\n",
+          sink.frames, (double) sink.frames / seconds, ns, ns / leds, (unsigned) sink.hash);
+  if(wire != nullptr) {
+    fprintf(stderr, "%s output: blocked %lu ms, %lu stalls\n",
+            wire, timed.blockedMicros / 1000, timed.stalls);
+  }
+  led.printStats(Serial);
+  return 0;
+}
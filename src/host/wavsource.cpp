@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include "wavsource.h"
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24); }
+static uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+boolean WavSource::load(const char* path) {
+  FILE* in = fopen(path, "rb");
+  if(in == nullptr) {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t n;
+  while((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    data.insert(data.end(), buffer, buffer + n);
+  }
+  fclose(in);
+  if(data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0) {
+    return false;
+  }
+
+  int channels = 0, bits = 0;
+  for(size_t at = 12; at + 8 <= data.size(); ) {
+    const uint8_t* chunk = &data[at];
+    size_t size = min((size_t) le32(&chunk[4]), data.size() - at - 8);
+    if(memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      if(le16(&chunk[8]) != 1) {
+        return false; // not PCM
+      }
+      channels = le16(&chunk[10]);
+      rate = le32(&chunk[12]);
+      bits = le16(&chunk[22]);
+    }
+    else if(memcmp(chunk, "data", 4) == 0 && channels > 0 && bits == 16) {
+      const uint8_t* p = &chunk[8];
+      for(size_t i = 0; i + 2 * channels <= size; i += 2 * channels) {
+        long sum = 0;
+        for(int c = 0; c < channels; c++) {
+          sum += (int16_t) le16(&p[i + 2 * c]);
+        }
+        pcm.push_back(sum / channels);
+      }
+    }
+    at += 8 + size + (size & 1);
+  }
+  return !pcm.empty();
+}
+
+int WavSource::sample() {
+  unsigned long long i = (unsigned long long) (micros() - start) * rate / 1000000;
+  if(i >= pcm.size()) {
+    return 512;
+  }
+  return 512 + (pcm[i] >> 6);
+}
@@ -0,0 +1,23 @@
+#ifndef __WAVSOURCE_H__
+#define __WAVSOURCE_H__
+
+#include <vector>
+#include "audio.h"
+
+// Plays a 16 bit PCM WAV file (mono or stereo, any rate) into Audio in
+// place of the microphone: sample() returns the sample at the current
+// virtual time, as a 10 bit value around 512 like analogRead().
+class WavSource : public SampleSource {
+
+  public:
+    // False if the file can not be read or is not 16 bit PCM
+    boolean load(const char* path);
+    int sample();
+
+    unsigned long rate = 0;
+    unsigned long start = 0;     // micros() at which playing starts
+    std::vector<int16_t> pcm;    // mono samples
+    double seconds() const { return rate ? (double) pcm.size() / rate : 0; }
+};
+
+#endif // __WAVSOURCE_H__
@@ -0,0 +1,26 @@
+#include "wiresink.h"
+
+WireSink::WireSink(uint16_t n, boolean async, FILE* out)
+  : RecordingSink(n, out), async(async), wireMicros(30UL * n + 300) {
+  bitBanged = !async;
+}
+
+boolean WireSink::canShow() {
+  return (long)(micros() - sendingUntil) >= 0;
+}
+
+void WireSink::show() {
+  if(!canShow()) {
+    unsigned long wait = sendingUntil - micros();
+    hostAdvanceMicros(wait);
+    blockedMicros += wait;
+    stalls++;
+  }
+  RecordingSink::show();
+  if(async) {
+    sendingUntil = micros() + wireMicros;
+  } else {
+    hostAdvanceMicros(wireMicros);
+    blockedMicros += wireMicros;
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef __WIRESINK_H__
+#define __WIRESINK_H__
+
+#include "recordingsink.h"
+
+// Recording sink that also takes the time a real strip needs to receive a
+// frame (30us per LED plus the 300us latch) on the virtual clock.
+//
+// Blocking, like Adafruit_NeoPixel: show() returns once the frame is sent.
+// Asynchronous, like the NeoPixelBus UART/DMA methods: show() starts the
+// transfer and returns, canShow() is false until it is done. A show()
+// before that waits for the wire, which is counted as a stall.
+class WireSink : public RecordingSink {
+
+  public:
+    WireSink(uint16_t n, boolean async, FILE* out = nullptr);
+
+    void show();
+    boolean canShow();
+
+    unsigned long blockedMicros = 0; // time show() kept the caller waiting
+    unsigned long stalls = 0;        // show() calls while still sending
+
+  private:
+    boolean async;
+    unsigned long wireMicros;
+    unsigned long sendingUntil = 0;
+};
+
+#endif // __WIRESINK_H__
@@ -0,0 +1,52 @@
+#ifndef __ASYNCSINK_H__
+#define __ASYNCSINK_H__
+
+// Asynchronous strip output for the ESP8266 through the NeoPixelBus
+// library. Adafruit_NeoPixel::show() bit-bangs with interrupts off for
+// about 30us per LED; these methods hand the frame to the UART or the I2S
+// DMA and return, so the next frame renders while this one is on the wire.
+// NeoPixelBus keeps its own send buffer, which together with LED's frame
+// buffer makes the double buffer.
+//
+// Methods (the pin is fixed by the hardware):
+//   NeoEsp8266AsyncUart1Ws2812xMethod  GPIO2 (D4)
+//   NeoEsp8266DmaWs2812xMethod         GPIO3 (RX), the Nextion can then no
+//                                      longer send to Serial
+//
+//   UartPixelSink strip(LED_COUNT);
+//   PixelSink* strips[] = { &strip };
+
+#include <NeoPixelBus.h>
+#include "pixelsink.h"
+
+template<typename METHOD> class NeoPixelBusSink : public PixelSink {
+
+  public:
+    NeoPixelBusSink(uint16_t n) : bus(n) {}
+
+    void begin() { bus.Begin(); }
+    uint16_t numPixels() const { return bus.PixelCount(); }
+    // NeoPixelBus has no brightness, the pixels are scaled as they are set.
+    // LED sends all pixels again after a change.
+    void setBrightness(uint8_t b) { brightness = b + 1; }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+      bus.SetPixelColor(n, RgbColor((r * brightness) >> 8, (g * brightness) >> 8, (b * brightness) >> 8));
+    }
+    using PixelSink::setPixelColor;
+    uint32_t getPixelColor(uint16_t n) const {
+      RgbColor c = bus.GetPixelColor(n);
+      return Color(c.R, c.G, c.B);
+    }
+    void clear() { bus.ClearTo(RgbColor(0)); }
+    void show() { bus.Show(); }
+    boolean canShow() { return bus.CanShow(); }
+
+  private:
+    NeoPixelBus<NeoBrgFeature, METHOD> bus;
+    uint16_t brightness = 256;
+};
+
+typedef NeoPixelBusSink<NeoEsp8266AsyncUart1Ws2812xMethod> UartPixelSink;
+typedef NeoPixelBusSink<NeoEsp8266DmaWs2812xMethod> DmaPixelSink;
+
+#endif // __ASYNCSINK_H__
@@ -0,0 +1,209 @@
+#include "audio.h"
+#ifdef ESP8266
+extern "C" {
+#include <user_interface.h>
+}
+#endif
+
+// sin(2*pi*k/64) in Q15 for the first quarter wave, k = 0..16
+static const int16_t sine15[AUDIO_SAMPLES / 4 + 1] PROGMEM = {
+  0, 3212, 6393, 9512, 12540, 15447, 18205, 20788, 23170,
+  25330, 27246, 28899, 30274, 31357, 32138, 32610, 32767
+};
+
+// Band edges in FFT bins (62.5 Hz each at 4 kHz), about an octave apart
+// at the low end
+static const uint8_t bandBins[AUDIO_BANDS + 1] = { 1, 2, 3, 4, 6, 8, 12, 17, 32 };
+
+// Raw band sums and levels below these are noise, not music
+#define AUDIO_BAND_FLOOR  256
+#define AUDIO_LEVEL_FLOOR 200
+
+static int16_t sin15(int k) {
+  k &= AUDIO_SAMPLES - 1;
+  if(k <= AUDIO_SAMPLES / 4) {
+    return pgm_read_word(&sine15[k]);
+  }
+  if(k <= AUDIO_SAMPLES / 2) {
+    return pgm_read_word(&sine15[AUDIO_SAMPLES / 2 - k]);
+  }
+  if(k <= AUDIO_SAMPLES * 3 / 4) {
+    return -pgm_read_word(&sine15[k - AUDIO_SAMPLES / 2]);
+  }
+  return -pgm_read_word(&sine15[AUDIO_SAMPLES - k]);
+}
+
+static int16_t cos15(int k) {
+  return sin15(k + AUDIO_SAMPLES / 4);
+}
+
+// In place radix 2 FFT in Q15. Every stage halves the values, so nothing
+// overflows and the result is the spectrum divided by AUDIO_SAMPLES.
+static void fft(int16_t* re, int16_t* im) {
+  const int n = AUDIO_SAMPLES;
+  for(int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for(; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if(i < j) {
+      int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+      t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+  }
+  for(int length = 2; length <= n; length <<= 1) {
+    const int half = length / 2;
+    const int step = n / length;
+    for(int k = 0; k < half; k++) {
+      const int32_t wr = cos15(k * step);
+      const int32_t wi = -sin15(k * step);
+      for(int a = k; a < n; a += length) {
+        const int b = a + half;
+        const int32_t tr = (wr * re[b] - wi * im[b]) >> 15;
+        const int32_t ti = (wr * im[b] + wi * re[b]) >> 15;
+        re[b] = (re[a] - tr) >> 1;
+        im[b] = (im[a] - ti) >> 1;
+        re[a] = (re[a] + tr) >> 1;
+        im[a] = (im[a] + ti) >> 1;
+      }
+    }
+  }
+}
+
+// Marks a gap in the ring, samples are 0 to 1023
+#define AUDIO_GAP -1
+
+#ifdef ESP8266
+static Audio* timed = nullptr;
+// Cycle count of the last sample and the us since begin() up to it.
+// micros() and analogRead() are in flash, which an interrupt must not
+// call, so the timer reads the cycle counter and the ADC (A0) directly.
+static uint32_t timedCycles = 0;
+static unsigned long timedMicros = 0;
+#define AUDIO_CYCLES_PER_US (F_CPU / 1000000)
+
+static void IRAM_ATTR onTimer() {
+  const uint32_t us = (ESP.getCycleCount() - timedCycles) / AUDIO_CYCLES_PER_US;
+  timedCycles += us * AUDIO_CYCLES_PER_US;
+  timedMicros += us;
+  timed->sample(timedMicros, system_adc_read());
+}
+#endif
+
+void Audio::begin() {
+#ifdef ESP8266
+  timed = this;
+  timedCycles = ESP.getCycleCount();
+  timer1_isr_init();
+  timer1_attachInterrupt(onTimer);
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+  timer1_write(5000000UL / AUDIO_RATE); // 80 MHz / 16 = 5 ticks per us
+#endif
+}
+
+boolean IRAM_ATTR Audio::put(int16_t value) {
+  const uint8_t next = (head + 1) & (AUDIO_RING - 1);
+  if(next == tail) {
+    return false;
+  }
+  ring[head] = value;
+  head = next;
+  return true;
+}
+
+void Audio::sample(unsigned long us) {
+  sample(us, source.sample());
+}
+
+// More than half a period late, the timer missed samples. The ones lost
+// are counted and poll() starts the block over at the gap.
+void IRAM_ATTR Audio::sample(unsigned long us, int value) {
+  const unsigned long period = 1000000UL / AUDIO_RATE;
+  const unsigned long late = us - lastSample;
+  boolean gap = lost;
+  if(sampled && late > period + period / 2) {
+    dropped += (late + period / 2) / period - 1;
+    gap = true;
+  }
+  lastSample = us;
+  sampled = true;
+  lost = (gap && !put(AUDIO_GAP)) || !put(value);
+  if(lost) {
+    dropped++;
+  }
+}
+
+// Only this runs between frames: the blocks are complete by the time
+// they are analyzed, however the frames fell between the samples.
+void Audio::poll() {
+  while(tail != head) {
+    const int value = ring[tail];
+    tail = (tail + 1) & (AUDIO_RING - 1);
+    if(value == AUDIO_GAP) {
+      restarts += count > 0;
+      count = 0;
+      continue;
+    }
+    samples[count++] = value;
+    if(count == AUDIO_SAMPLES) {
+      analyze(samples);
+      count = 0;
+    }
+  }
+}
+
+boolean Audio::sampling() const {
+  const int taken = count + ((head - tail) & (AUDIO_RING - 1));
+  return taken % AUDIO_SAMPLES >= AUDIO_SHOW_SAMPLES;
+}
+
+void Audio::analyze(const int* block) {
+  int16_t re[AUDIO_SAMPLES];
+  int16_t im[AUDIO_SAMPLES];
+  unsigned long amplitude = 0;
+
+  // Remove the DC offset, scale the 10 bit samples up and apply a Hann
+  // window
+  for(int i = 0; i < AUDIO_SAMPLES; i++) {
+    dc += block[i] - (dc >> 8);
+    int32_t x = constrain(((long) block[i] - (dc >> 8)) << 5, -32767L, 32767L);
+    amplitude += abs(x);
+    const int32_t window = (32767 - cos15(i)) >> 1;
+    re[i] = (x * window) >> 15;
+    im[i] = 0;
+  }
+  fft(re, im);
+
+  // Bin magnitudes (max + min/2, close enough to the root of the squares)
+  // summed up per band, scaled to the highest band of the last seconds
+  unsigned long sums[AUDIO_BANDS];
+  unsigned long loudest = 0;
+  for(int b = 0; b < AUDIO_BANDS; b++) {
+    sums[b] = 0;
+    for(int k = bandBins[b]; k < bandBins[b + 1]; k++) {
+      unsigned long x = abs(re[k]), y = abs(im[k]);
+      sums[b] += x > y ? x + y / 2 : y + x / 2;
+    }
+    loudest = max(loudest, sums[b]);
+  }
+  bandPeak = max(max(loudest, bandPeak - bandPeak / 64), (unsigned long) AUDIO_BAND_FLOOR);
+  for(int b = 0; b < AUDIO_BANDS; b++) {
+    band[b] = sums[b] * 255 / bandPeak;
+  }
+
+  amplitude /= AUDIO_SAMPLES;
+  levelPeak = max(max(amplitude, levelPeak - levelPeak / 64), (unsigned long) AUDIO_LEVEL_FLOOR);
+  loudness = amplitude * 255 / levelPeak;
+
+  // A beat: the two lowest bands well above their running average
+  unsigned long bass = sums[0] + sums[1];
+  const unsigned long spacing = (unsigned long) AUDIO_BEAT_MS * AUDIO_RATE / 1000 / AUDIO_SAMPLES;
+  if(bass > bassAverage + bassAverage / 2 && bass > AUDIO_BAND_FLOOR &&
+     blocks - lastBeat >= spacing) {
+    beatCount++;
+    lastBeat = blocks;
+  }
+  bassAverage = bassAverage + bass / 8 - bassAverage / 8;
+  blocks++;
+}
@@ -0,0 +1,101 @@
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include <Arduino.h>
+
+// Blocks of AUDIO_SAMPLES samples (the FFT's twiddle table is made for 64)
+// taken at AUDIO_RATE, split into AUDIO_BANDS bands
+#define AUDIO_SAMPLES 64
+#define AUDIO_BANDS    8
+#ifndef AUDIO_RATE
+#define AUDIO_RATE  4000
+#endif
+// Samples held between the timer and poll(), two blocks (a power of 2)
+#define AUDIO_RING   128
+// Samples into a block a show with the interrupts off may still start,
+// see sampling()
+#define AUDIO_SHOW_SAMPLES 4
+// Shortest time between two beats (ms)
+#define AUDIO_BEAT_MS 200
+
+// Where the samples come from: 10 bit values around 512, like analogRead()
+class SampleSource {
+
+  public:
+    virtual ~SampleSource() {}
+    virtual int sample() = 0;
+};
+
+// A microphone amplifier on an analog pin
+class AnalogSource : public SampleSource {
+
+  public:
+    AnalogSource(uint8_t pin) : pin(pin) {}
+    int sample() { return analogRead(pin); }
+
+  private:
+    uint8_t pin;
+};
+
+// Music analysis for the audio effects. The samples are taken from a
+// timer interrupt at AUDIO_RATE into a ring buffer, so they keep their
+// spacing however long a frame takes; LED polls it between frames, where
+// it runs a 64 point fixed point FFT on every full block, so a frame never
+// waits for audio. A sample that comes late (the interrupts were off, e.g.
+// for a bit-banged show) starts the block over rather than joining sound
+// from before and after the gap. The effects read the band levels, the
+// overall level (0-255, each scaled to the recent peak) and a counter of
+// the beats found in the low bands.
+class Audio {
+
+  public:
+    Audio(SampleSource& source) : source(source) {}
+
+    // Take the samples from timer1 from now on (ESP8266); the timer reads
+    // A0 itself, not through the source. Elsewhere sample() has to be
+    // called at AUDIO_RATE instead, e.g. by a host tool.
+    void begin();
+    // Take one sample from the source at 'us'
+    void sample(unsigned long us);
+    // Store 'value', taken at 'us'; safe in an interrupt
+    void sample(unsigned long us, int value);
+    // Analyze the full blocks taken so far
+    void poll();
+    // True while a block is being taken. Outputs that turn the interrupts
+    // off wait for the next one to start, or they would cut it short.
+    boolean sampling() const;
+    // Run the analysis on a block of AUDIO_SAMPLES samples
+    void analyze(const int* block);
+
+    const uint8_t* bands() const { return band; }
+    uint8_t level() const { return loudness; }
+    unsigned long beats() const { return beatCount; }
+
+    unsigned long blocks = 0;
+    volatile unsigned long dropped = 0; // samples missed: late or ring full
+    unsigned long restarts = 0;         // blocks started over after a gap
+
+  private:
+    boolean put(int16_t value);
+
+    SampleSource& source;
+    volatile int16_t ring[AUDIO_RING];
+    volatile uint8_t head = 0; // next slot sample() fills
+    volatile uint8_t tail = 0; // next slot poll() reads
+    unsigned long lastSample = 0;
+    boolean sampled = false;
+    boolean lost = false;      // the last sample did not fit
+    int samples[AUDIO_SAMPLES];
+    int count = 0;
+
+    long dc = 512L << 8;       // running mean of the samples, 8 bit fraction
+    uint8_t band[AUDIO_BANDS] = {};
+    uint8_t loudness = 0;
+    unsigned long bandPeak = 0;
+    unsigned long levelPeak = 0;
+    unsigned long bassAverage = 0;
+    unsigned long beatCount = 0;
+    unsigned long lastBeat = 0; // block of the last beat
+};
+
+#endif // __AUDIO_H__
@@ -0,0 +1,77 @@
+#ifndef __DDPINPUT_H__
+#define __DDPINPUT_H__
+
+// DDP (Distributed Display Protocol) frames over UDP, e.g. from xLights or
+// WLED, as an alternative to Adalight on the serial line. Each packet has a
+// 10 byte header (14 with a timecode): flags, sequence, data type, id, the
+// byte offset (32 bit) and the data length (16 bit), big endian. The data
+// is r,g,b and is read from the packet straight into the frame; a packet
+// with the PUSH flag completes the frame. Only packets of RGB data (or of
+// no stated type) for the display, id 1, starting at an LED within the
+// strip are written.
+//
+//   WiFiUDP udp;
+//   udp.begin(DDP_PORT);
+//   DdpInput ddp(udp);
+//   led->setInput(&ddp);
+
+#include <Udp.h>
+#include "pixelinput.h"
+
+#define DDP_PORT 4048
+
+#define DDP_FLAG_TIMECODE 0x10
+#define DDP_FLAG_PUSH     0x01
+
+#define DDP_TYPE_UNDEFINED 0x00
+#define DDP_TYPE_RGB24     0x0b // RGB, 8 bits per channel
+#define DDP_ID_DISPLAY     1
+
+class DdpInput : public PixelInput {
+
+  public:
+    DdpInput(UDP& udp) : udp(udp) {}
+
+    boolean poll(uint8_t* pixels, int count, int& from, int& to) {
+      // One packet per poll keeps the work per call bounded
+      if(udp.parsePacket() < 10) {
+        return false;
+      }
+      byte header[14];
+      udp.read(header, 10);
+      if(header[0] & DDP_FLAG_TIMECODE) {
+        udp.read(&header[10], 4);
+      }
+      const uint32_t offset = ((uint32_t) header[4] << 24) | ((uint32_t) header[5] << 16) |
+                              ((uint32_t) header[6] << 8) | header[7];
+      const uint32_t length = ((uint32_t) header[8] << 8) | header[9];
+      const uint32_t limit = (uint32_t) count * 3;
+      const boolean rgb = header[2] == DDP_TYPE_UNDEFINED || header[2] == DDP_TYPE_RGB24;
+      if(rgb && header[3] == DDP_ID_DISPLAY && offset < limit && offset % 3 == 0) {
+        const long read = udp.read(&pixels[offset], min(length, limit - offset));
+        if(read > 0) {
+          dirtyFrom = min(dirtyFrom, (long) offset / 3);
+          dirtyTo = max(dirtyTo, ((long) offset + read + 2) / 3);
+        }
+      }
+      udp.flush();
+      if(!(header[0] & DDP_FLAG_PUSH) || dirtyFrom >= dirtyTo) {
+        return false;
+      }
+      from = dirtyFrom;
+      to = dirtyTo;
+      dirtyFrom = 0x7fffffff;
+      dirtyTo = 0;
+      frames++;
+      return true;
+    }
+
+    unsigned long frames = 0;
+
+  private:
+    UDP& udp;
+    long dirtyFrom = 0x7fffffff; // LEDs written since the last PUSH
+    long dirtyTo = 0;
+};
+
+#endif // __DDPINPUT_H__
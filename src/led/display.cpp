@@ -0,0 +1,48 @@
+#include "display.h"
+
+#define NEX_TOUCH_EVENT 0x65
+#define NEX_NUMBER      0x71
+
+boolean Display::poll(uint8_t& component, uint32_t& value) {
+  for(int budget = DISPLAY_MAX_BYTES; budget > 0 && serial.available() > 0; budget--) {
+    const uint8_t c = serial.read();
+    if(length < (int) sizeof(message)) {
+      message[length] = c;
+    }
+    length++;
+
+    // The fixed part may hold 0xff itself, only count the end after it
+    const int fixed = message[0] == NEX_TOUCH_EVENT ? 4 : message[0] == NEX_NUMBER ? 5 : 1;
+    if(length <= fixed) {
+      continue;
+    }
+    ends = c == 0xff ? ends + 1 : 0;
+    if(ends < 3) {
+      continue;
+    }
+    const int size = length;
+    length = 0;
+    ends = 0;
+    if(message[0] == NEX_TOUCH_EVENT && size == 7 && message[3] == 0x00) {
+      released = message[2];
+    }
+    else if(message[0] == NEX_NUMBER && size == 8 && released >= 0) {
+      component = released;
+      value = message[1] | ((uint32_t) message[2] << 8) |
+              ((uint32_t) message[3] << 16) | ((uint32_t) message[4] << 24);
+      released = -1;
+      events++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Display::setValue(const char* name, uint32_t value) {
+  serial.print(name);
+  serial.print(".val=");
+  serial.print((long) value);
+  serial.write(0xff);
+  serial.write(0xff);
+  serial.write(0xff);
+}
@@ -0,0 +1,37 @@
+#ifndef __DISPLAY_H__
+#define __DISPLAY_H__
+
+#include <Arduino.h>
+
+// Most bytes read from the display per poll
+#define DISPLAY_MAX_BYTES 32
+
+// Nextion display on a serial line, without waiting for it in either
+// direction. Every message from the display ends in 0xff 0xff 0xff. The
+// release event of each control sends its component id ("Send Component
+// ID" ticked) and then its value from the event code, e.g. `get h1.val`:
+//   0x65 page component 0x00 ff ff ff   then   0x71 value (32 bit LE) ff ff ff
+// so nothing has to be asked back. Values are set without waiting for the
+// display's answer.
+class Display {
+
+  public:
+    Display(Stream& serial) : serial(serial) {}
+
+    // Read what has arrived. True when a released control's value came
+    // in; 'component' and 'value' then hold them.
+    boolean poll(uint8_t& component, uint32_t& value);
+    // Set the value of control 'name' (e.g. "h0")
+    void setValue(const char* name, uint32_t value);
+
+    unsigned long events = 0;
+
+  private:
+    Stream& serial;
+    uint8_t message[8];
+    int length = 0;    // bytes of the message so far
+    int ends = 0;      // 0xff in a row after its fixed part
+    int released = -1; // component waiting for its value
+};
+
+#endif // __DISPLAY_H__
@@ -0,0 +1,43 @@
+#include "framestats.h"
+
+void FrameStats::add(unsigned long us) {
+  int bucket = min(us / FRAMESTATS_BUCKET_US, (unsigned long) FRAMESTATS_BUCKETS - 1);
+  buckets[bucket]++;
+  frames++;
+  total += us;
+  if(us > longest) {
+    longest = us;
+  }
+
+  if(frames >= FRAMESTATS_WINDOW) {
+    for(int i = 0; i < FRAMESTATS_BUCKETS; i++) {
+      buckets[i] /= 2;
+    }
+    frames /= 2;
+    total /= 2;
+  }
+}
+
+void FrameStats::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  frames = 0;
+  total = 0;
+  longest = 0;
+}
+
+unsigned long FrameStats::percentile(int pct) const {
+  unsigned long counted = 0;
+  unsigned long wanted = 0;
+  for(int i = 0; i < FRAMESTATS_BUCKETS; i++) {
+    wanted += buckets[i];
+  }
+  wanted = (wanted * pct + 99) / 100;
+  for(int i = 0; i < FRAMESTATS_BUCKETS; i++) {
+    counted += buckets[i];
+    if(counted >= wanted) {
+      // The last bucket has no upper bound of its own
+      return i < FRAMESTATS_BUCKETS - 1 ? (i + 1) * FRAMESTATS_BUCKET_US : longest;
+    }
+  }
+  return longest;
+}
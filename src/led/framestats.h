@@ -0,0 +1,34 @@
+#ifndef __FRAMESTATS_H__
+#define __FRAMESTATS_H__
+
+#include <Arduino.h>
+
+// Rolling statistics over frame times in microseconds. Times go into a
+// histogram of FRAMESTATS_BUCKETS buckets FRAMESTATS_BUCKET_US wide (the
+// last one collects everything longer). Once FRAMESTATS_WINDOW frames are
+// counted all counts are halved, so old frames fade out of the statistics.
+#define FRAMESTATS_BUCKETS   64
+#define FRAMESTATS_BUCKET_US 256
+#define FRAMESTATS_WINDOW    1024
+
+class FrameStats {
+
+  public:
+    void add(unsigned long us);
+    void reset();
+
+    unsigned long count() const { return frames; }
+    unsigned long mean() const { return frames ? total / frames : 0; }
+    unsigned long maximum() const { return longest; }
+    // Upper bound of the bucket holding the given percentile, the longest
+    // frame if it is the last one
+    unsigned long percentile(int pct) const;
+
+  private:
+    uint16_t buckets[FRAMESTATS_BUCKETS] = {};
+    unsigned long frames = 0;
+    unsigned long total = 0;
+    unsigned long longest = 0;
+};
+
+#endif // __FRAMESTATS_H__
@@ -0,0 +1,43 @@
+#include "layout.h"
+
+void Layout::matrix(boolean serpentine, boolean columns, int quarterTurns) {
+  quarterTurns &= 3;
+  // The wired (physical) matrix is width x height before the turns
+  const int w = quarterTurns & 1 ? height : width;
+  const int h = quarterTurns & 1 ? width : height;
+  for(int y = 0; y < height; y++) {
+    for(int x = 0; x < width; x++) {
+      // Logical cell back to its place in the wired matrix
+      int u = x, v = y;
+      switch(quarterTurns) {
+        case 1: u = y;         v = h - 1 - x; break;
+        case 2: u = w - 1 - x; v = h - 1 - y; break;
+        case 3: u = w - 1 - y; v = x;         break;
+      }
+      uint16_t i;
+      if(columns) {
+        i = u * h + (serpentine && (u & 1) ? h - 1 - v : v);
+      }
+      else {
+        i = v * w + (serpentine && (v & 1) ? w - 1 - u : u);
+      }
+      table[y * width + x] = i;
+    }
+  }
+}
+
+void Layout::spiral(float ledsPerTurn) {
+  for(int y = 0; y < height; y++) {
+    const int turn = height - 1 - y;
+    for(int x = 0; x < width; x++) {
+      long i = lround((turn + (float) x / width) * ledsPerTurn);
+      table[y * width + x] = i < LAYOUT_NONE ? i : LAYOUT_NONE;
+    }
+  }
+}
+
+void Layout::custom(const uint16_t* indices) {
+  for(int i = 0; i < width * height; i++) {
+    table[i] = pgm_read_word(&indices[i]);
+  }
+}
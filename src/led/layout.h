@@ -0,0 +1,44 @@
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#include <Arduino.h>
+
+// Unused cells of a layout (no LED there)
+#define LAYOUT_NONE 0xffff
+
+// Where the LEDs of a matrix or a wound column sit: maps logical (x, y)
+// to the LED index within its segment. The table is filled once when the
+// layout is set up, a lookup is a single load from it. The 2D effects take
+// one row at a time, see row().
+class Layout {
+
+  public:
+    // 'table' has room for width * height entries and is not owned (make
+    // it static, like the LED buffer)
+    Layout(uint16_t* table, int width, int height)
+      : width(width), height(height), table(table) {}
+
+    // A matrix wired row by row ('columns': column by column) from the top
+    // left, every other row in the opposite direction if 'serpentine'.
+    // Each of 'quarterTurns' turns the picture 90 degrees clockwise; odd
+    // turns swap width and height.
+    void matrix(boolean serpentine, boolean columns = false, int quarterTurns = 0);
+    // Polar: a strip wound around a column from the bottom up with
+    // 'ledsPerTurn' LEDs (need not be whole) per turn. x is the angle in
+    // 'width' steps around the column, y the turn counted from the top.
+    void spiral(float ledsPerTurn);
+    // Any other wiring: LED index of every cell, row by row (PROGMEM)
+    void custom(const uint16_t* indices);
+
+    const uint16_t* row(int y) const { return &table[y * width]; }
+    uint16_t index(int x, int y) const { return table[y * width + x]; }
+    int size() const { return width * height; }
+
+    int width;
+    int height;
+
+  private:
+    uint16_t* table;
+};
+
+#endif // __LAYOUT_H__
@@ -12,99 +12,631 @@
 
 #include "led.h"
 
-#include <Nextion.h>
+// Nextion controls on page 0: component ids for the events, object names
+// for the values
+#define NEX_PROGRESS   13 // "h0", shows the effect number
+#define NEX_RANDOM     14 // "bt0"
+#define NEX_BRIGHTNESS 15 // "h1"
+#define NEX_VELOCITY   16 // "h2"
+#define NEX_STATIC     17 // "bt1"
 
-NexDSButton btn(0, 14, "bt0");
-NexProgressBar progress(0, 13, "h0");
+#if LED_FIXED_POINT
+// sin(x) * 127 + 128 for one full wave in 256 steps
+static const uint8_t sine8[256] PROGMEM = {
+  128, 131, 134, 137, 140, 144, 147, 150, 153, 156, 159, 162, 165, 168, 171, 174,
+  177, 179, 182, 185, 188, 191, 193, 196, 199, 201, 204, 206, 209, 211, 213, 216,
+  218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 239, 240, 241, 243, 244,
+  245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+  255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+  245, 244, 243, 241, 240, 239, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+  218, 216, 213, 211, 209, 206, 204, 201, 199, 196, 193, 191, 188, 185, 182, 179,
+  177, 174, 171, 168, 165, 162, 159, 156, 153, 150, 147, 144, 140, 137, 134, 131,
+  128, 125, 122, 119, 116, 112, 109, 106, 103, 100,  97,  94,  91,  88,  85,  82,
+   79,  77,  74,  71,  68,  65,  63,  60,  57,  55,  52,  50,  47,  45,  43,  40,
+   38,  36,  34,  32,  30,  28,  26,  24,  22,  21,  19,  17,  16,  15,  13,  12,
+   11,  10,   8,   7,   6,   6,   5,   4,   3,   3,   2,   2,   2,   1,   1,   1,
+    1,   1,   1,   1,   2,   2,   2,   3,   3,   4,   5,   6,   6,   7,   8,  10,
+   11,  12,  13,  15,  16,  17,  19,  21,  22,  24,  26,  28,  30,  32,  34,  36,
+   38,  40,  43,  45,  47,  50,  52,  55,  57,  60,  63,  65,  68,  71,  74,  77,
+   79,  82,  85,  88,  91,  94,  97, 100, 103, 106, 109, 112, 116, 119, 122, 125,
+};
 
-void btnRelease(void *ptr) {
-  digitalWrite(BUILTIN_LED, !digitalRead(BUILTIN_LED));
-}
+// RunningLights steps the wave by one radian per pixel: 256/(2*pi) table
+// steps, as 8.8 fixed point.
+#define SINE8_PER_RADIAN 10430UL
+#endif
+
+// Fire palette: heat 0..255 scaled to 0..191 and ramped through
+// black -> red -> yellow -> white in three steps of 64
+static const uint8_t heatColors[256][3] PROGMEM = {
+  {  0,  0,  0}, {  4,  0,  0}, {  4,  0,  0}, {  8,  0,  0}, { 12,  0,  0}, { 16,  0,  0},
+  { 16,  0,  0}, { 20,  0,  0}, { 24,  0,  0}, { 28,  0,  0}, { 28,  0,  0}, { 32,  0,  0},
+  { 36,  0,  0}, { 40,  0,  0}, { 40,  0,  0}, { 44,  0,  0}, { 48,  0,  0}, { 52,  0,  0},
+  { 52,  0,  0}, { 56,  0,  0}, { 60,  0,  0}, { 64,  0,  0}, { 64,  0,  0}, { 68,  0,  0},
+  { 72,  0,  0}, { 76,  0,  0}, { 76,  0,  0}, { 80,  0,  0}, { 84,  0,  0}, { 88,  0,  0},
+  { 88,  0,  0}, { 92,  0,  0}, { 96,  0,  0}, {100,  0,  0}, {100,  0,  0}, {104,  0,  0},
+  {108,  0,  0}, {112,  0,  0}, {112,  0,  0}, {116,  0,  0}, {120,  0,  0}, {124,  0,  0},
+  {124,  0,  0}, {128,  0,  0}, {132,  0,  0}, {136,  0,  0}, {136,  0,  0}, {140,  0,  0},
+  {144,  0,  0}, {148,  0,  0}, {148,  0,  0}, {152,  0,  0}, {156,  0,  0}, {160,  0,  0},
+  {160,  0,  0}, {164,  0,  0}, {168,  0,  0}, {172,  0,  0}, {172,  0,  0}, {176,  0,  0},
+  {180,  0,  0}, {184,  0,  0}, {184,  0,  0}, {188,  0,  0}, {192,  0,  0}, {196,  0,  0},
+  {196,  0,  0}, {200,  0,  0}, {204,  0,  0}, {208,  0,  0}, {208,  0,  0}, {212,  0,  0},
+  {216,  0,  0}, {220,  0,  0}, {220,  0,  0}, {224,  0,  0}, {228,  0,  0}, {232,  0,  0},
+  {232,  0,  0}, {236,  0,  0}, {240,  0,  0}, {244,  0,  0}, {244,  0,  0}, {248,  0,  0},
+  {252,  0,  0}, {  0,  0,  0}, {  0,  0,  0}, {255,  4,  0}, {255,  8,  0}, {255, 12,  0},
+  {255, 12,  0}, {255, 16,  0}, {255, 20,  0}, {255, 24,  0}, {255, 24,  0}, {255, 28,  0},
+  {255, 32,  0}, {255, 36,  0}, {255, 36,  0}, {255, 40,  0}, {255, 44,  0}, {255, 48,  0},
+  {255, 48,  0}, {255, 52,  0}, {255, 56,  0}, {255, 60,  0}, {255, 60,  0}, {255, 64,  0},
+  {255, 68,  0}, {255, 72,  0}, {255, 72,  0}, {255, 76,  0}, {255, 80,  0}, {255, 84,  0},
+  {255, 84,  0}, {255, 88,  0}, {255, 92,  0}, {255, 96,  0}, {255, 96,  0}, {255,100,  0},
+  {255,104,  0}, {255,108,  0}, {255,108,  0}, {255,112,  0}, {255,116,  0}, {255,120,  0},
+  {255,120,  0}, {255,124,  0}, {255,128,  0}, {255,132,  0}, {255,132,  0}, {255,136,  0},
+  {255,140,  0}, {255,144,  0}, {255,144,  0}, {255,148,  0}, {255,152,  0}, {255,156,  0},
+  {255,156,  0}, {255,160,  0}, {255,164,  0}, {255,168,  0}, {255,168,  0}, {255,172,  0},
+  {255,176,  0}, {255,180,  0}, {255,180,  0}, {255,184,  0}, {255,188,  0}, {255,192,  0},
+  {255,192,  0}, {255,196,  0}, {255,200,  0}, {255,204,  0}, {255,204,  0}, {255,208,  0},
+  {255,212,  0}, {255,216,  0}, {255,216,  0}, {255,220,  0}, {255,224,  0}, {255,228,  0},
+  {255,228,  0}, {255,232,  0}, {255,236,  0}, {255,240,  0}, {255,240,  0}, {255,244,  0},
+  {255,248,  0}, {255,252,  0}, {255,252,  0}, {255,  0,  0}, {255,255,  4}, {255,255,  8},
+  {255,255,  8}, {255,255, 12}, {255,255, 16}, {255,255, 20}, {255,255, 20}, {255,255, 24},
+  {255,255, 28}, {255,255, 32}, {255,255, 32}, {255,255, 36}, {255,255, 40}, {255,255, 44},
+  {255,255, 44}, {255,255, 48}, {255,255, 52}, {255,255, 56}, {255,255, 56}, {255,255, 60},
+  {255,255, 64}, {255,255, 68}, {255,255, 68}, {255,255, 72}, {255,255, 76}, {255,255, 80},
+  {255,255, 80}, {255,255, 84}, {255,255, 88}, {255,255, 92}, {255,255, 92}, {255,255, 96},
+  {255,255,100}, {255,255,104}, {255,255,104}, {255,255,108}, {255,255,112}, {255,255,116},
+  {255,255,116}, {255,255,120}, {255,255,124}, {255,255,128}, {255,255,128}, {255,255,132},
+  {255,255,136}, {255,255,140}, {255,255,140}, {255,255,144}, {255,255,148}, {255,255,152},
+  {255,255,152}, {255,255,156}, {255,255,160}, {255,255,164}, {255,255,164}, {255,255,168},
+  {255,255,172}, {255,255,176}, {255,255,176}, {255,255,180}, {255,255,184}, {255,255,188},
+  {255,255,188}, {255,255,192}, {255,255,196}, {255,255,200}, {255,255,200}, {255,255,204},
+  {255,255,208}, {255,255,212}, {255,255,212}, {255,255,216}, {255,255,220}, {255,255,224},
+  {255,255,224}, {255,255,228}, {255,255,232}, {255,255,236}, {255,255,236}, {255,255,240},
+  {255,255,244}, {255,255,248}, {255,255,248}, {255,255,252},
+};
 
 LED::LED(int ledCount, int pin) {
-  strip = new Adafruit_NeoPixel(ledCount, pin, NEO_BRG + NEO_KHZ800);
-  strip->begin();
-  strip->setBrightness(brightness);
-  setAll(0,0,0); // Set all black
+  outputs[0] = new NeoPixelSink(ledCount, pin, NEO_BRG + NEO_KHZ800);
+  numOutputs = 1;
+  ownsOutputs = true;
+  begin();
+}
+
+LED::LED(PixelSink* sink) {
+  outputs[0] = sink;
+  numOutputs = 1;
+  begin();
+}
+
+LED::LED(PixelSink** sinks, int count) {
+  numOutputs = min(count, LED_OUTPUTS);
+  for(int o = 0; o < numOutputs; o++) {
+    outputs[o] = sinks[o];
+  }
+  begin();
+}
+
+LED::LED(PixelSink** sinks, int count, uint8_t* buffer, size_t size) {
+  numOutputs = min(count, LED_OUTPUTS);
+  for(int o = 0; o < numOutputs; o++) {
+    outputs[o] = sinks[o];
+  }
+  this->buffer = buffer;
+  bufferSize = size;
+  begin();
+}
+
+void LED::begin() {
+  totalLeds = 0;
+  for(int o = 0; o < numOutputs; o++) {
+    outputStart[o] = totalLeds;
+    totalLeds += outputs[o]->numPixels();
+  }
+  if(buffer == nullptr) {
+    bufferSize = LED_BUFFER_SIZE(totalLeds);
+    buffer = new uint8_t[bufferSize];
+    ownsBuffer = true;
+  }
+  while(numOutputs > 0 && bufferSize < (size_t) LED_BUFFER_SIZE(totalLeds)) {
+    totalLeds = outputStart[--numOutputs];
+  }
 
-  randomSeed(random(326874522));
+  // One block for all per LED data, the 16 bit hue offsets first
+  memset(buffer, 0, LED_BUFFER_SIZE(totalLeds));
+  hueOffsets = (uint16_t*) buffer;
+  levels = &hueOffsets[totalLeds];
+  load = 0;
+  wide = &levels[totalLeds];
+  frame = &buffer[totalLeds * 10];
+  outgoingFrame = &frame[totalLeds * 3];
+  for(int l = 0; l < LED_LAYERS; l++) {
+    layers[l].frame = &outgoingFrame[totalLeds * 3 * (l + 1)];
+  }
+  heat = &outgoingFrame[totalLeds * 3 * (LED_LAYERS + 1)];
+  residual = &heat[totalLeds];
+  setSegment(0, 0, totalLeds, -1);
+  hueRing.setHueRing();
+  for(int o = 0; o < numOutputs; o++) {
+    outputs[o]->begin();
+    outputs[o]->setBrightness(255); // scaled in send()
+    // Its refreshes would keep a bit-banged strip sending between frames
+    dithering &= !outputs[o]->blocksInterrupts();
+    outputs[o]->clear(); // Set all black
+    outputs[o]->show();
+  }
+  dirtyFrom = totalLeds;
+  dirtyTo = 0;
+  for(int o = 0; o < numOutputs; o++) {
+    pendingFrom[o] = totalLeds;
+    pendingTo[o] = 0;
+    grain[o] = 0;
+  }
+  setTargetFps(LED_TARGET_FPS);
+
+  rng.seed(LED_SEED);
   nextEffect();
+}
+
+// Nothing goes to the display before the first loop(), so it can still be
+// turned off with setDisplay(false) after the constructor
+void LED::setDisplay(boolean on) {
+  display = on;
+}
+
+void LED::startDisplay() {
+  displayStarted = true;
+  nextion.setValue("bt0", randomEffect?1:0);
+  nextion.setValue("bt1", staticEffect?1:0);
+  nextion.setValue("h1", brightness);
+  nextion.setValue("h2", velocity);
+}
+
+// Let 'length' LEDs from 'start' on (counted across all outputs) run their
+// own effect with its own timing. Segment 0 runs the effect rotation with
+// its transitions and layers and covers all LEDs unless changed here.
+boolean LED::setSegment(int segment, int start, int length, int effect) {
+  if(segment < 0 || segment >= LED_SEGMENTS ||
+     start < 0 || length <= 0 || start + length > totalLeds ||
+     (segment == 0 ? effect != -1 : effect < 0 || effect >= numEffects)) {
+    return false;
+  }
+  Segment& seg = segments[segment];
+  seg.start = start;
+  seg.length = length;
+  if(segment > 0) {
+    startEffect(seg.fx, effect);
+  }
+  numSegments = max(numSegments, segment + 1);
+
+  // Rainbow hue offsets run once around the color wheel per segment
+  for(int i = 0; i < length; i++) {
+    hueOffsets[start + i] = i * 65536L / length;
+  }
+  dirtyFrom = 0;
+  dirtyTo = totalLeds;
+  return true;
+}
+
+boolean LED::setLayout(int segment, const Layout* layout) {
+  if(segment < 0 || segment >= LED_SEGMENTS ||
+     (layout != nullptr && layout->size() > segments[segment].length)) {
+    return false;
+  }
+  segments[segment].layout = layout;
+  dirtyFrom = 0;
+  dirtyTo = totalLeds;
+  return true;
+}
+
+// A control on the display was released; its new value came with it
+void LED::touch(uint8_t component, uint32_t value) {
+  switch(component) {
+    case NEX_RANDOM:
+      randomEffect = value != 0;
+      break;
+    case NEX_STATIC:
+      staticEffect = value != 0;
+      break;
+    case NEX_BRIGHTNESS:
+      setBrightness(value);
+      break;
+    case NEX_VELOCITY:
+      setVelocity(value);
+      break;
+  }
+}
+
+// Goes to the strips with the next frame, see commit()
+void LED::setBrightness(int brightness) {
+  this->brightness = constrain(brightness, 0, 255);
+}
 
-  btn.attachPop(btnRelease);
-  btn.setValue(randomEffect?1:0);
+void LED::setVelocity(int velocity) {
+  this->velocity = max(velocity, 0);
+}
+
+void LED::setTransition(unsigned long ms) {
+  transitionMs = ms;
+}
+
+void LED::setDithering(boolean on) {
+  dithering = on;
 }
 
 LED::~LED() {
-  if(strip != nullptr) {
-    delete strip;
-    strip = nullptr;
+  if(ownsBuffer) {
+    delete[] buffer;
+  }
+  if(ownsOutputs) {
+    for(int o = 0; o < numOutputs; o++) {
+      delete outputs[o];
+      outputs[o] = nullptr;
+    }
   }
 }
 
 void LED::loop() {
-  static long time = 0;
-  static long duration = 15000;
+  static unsigned long time = 0;
+  static unsigned long duration = 15000;
 
-  if(millis() - time > duration) {
+  // Touch events are picked up between frames, at most NEXTION_POLL_MS plus
+  // one frame's render time after they arrive. Only bytes that are already
+  // there are read, so the display never holds up a frame.
+  if(display && !displayStarted) {
+    startDisplay();
+  }
+  if(display && millis() - lastPoll >= NEXTION_POLL_MS) {
+    lastPoll = millis();
+    uint8_t component;
+    uint32_t value;
+    if(nextion.poll(component, value)) {
+      touch(component, value);
+    }
+  }
+  if(sequence == nullptr && millis() - time > duration) {
     nextEffect();
     time = millis();
   }
-  switch(effect) {
-    case  0: SnowSparkle(0x10, 0x10, 0x10, 20, 200);
-             break;
-    case  1: Sparkle(random(255), random(255), random(255), 0);
-             break;
-    case  2: TwinkleRandom(20, 100, false);
-             break;
-    case  3: Twinkle(random(255), random(255), random(255), 10, 100, false);
-             break;
-    case  4: rainbow(velocity / 5);
-             break;
-    case  5: if(random(100) < 50) {
-               Strobe(0xff, 0xff, 0xff, 10, 50, 0);
-             }
-             meteorRain(0xff,0xff,0xff,10, 64, true, 30);
-             if(random(100) < 30) {
-               Strobe(0xff, 0xff, 0xff, 10, 50, 0);
-             }
-             break;
-    case  6: RunningLights(random(255), random(255), random(255), 50);
-             break;
-    case  7: NewKITT(random(255), random(255), random(255), 8, 10, 50);
-             break;
-    case  8: FadeInOut(random(255), random(255), random(255));
-             break;
-    case  9: colorWipe(strip->Color(random(255), random(255), random(255)), velocity);
-             break;
-    case 10: theaterChase(strip->Color(random(255), random(255), random(255)), velocity);
-             break;
-    case 11: theaterChaseRainbow(velocity);
-             break;
-    default: nextEffect();
-  }
-  
+  step(millis());
+  updateDisplay(millis());
+}
+
+// Writes to the display cost serial time, so the effect number is only
+// sent when it changed and no more often than every NEXTION_UPDATE_MS.
+void LED::updateDisplay(unsigned long now) {
+  if(!display || effect == shownEffect || now - lastUpdate < NEXTION_UPDATE_MS) {
+    return;
+  }
+  lastUpdate = now;
+  shownEffect = effect;
+  nextion.setValue("h0", effect);
+}
+
+void LED::step(unsigned long now) {
+  pollInput(now);
+  if(audio != nullptr) {
+    audio->poll();
+  }
+  if(sequence != nullptr) {
+    sequence->run(*this, now);
+  }
+  if(pending) {
+    commit(now); // outputs that were still sending when the frame was done
+  }
+  unsigned long start = micros();
+  if(framePeriod > 0 && (long)(start - nextTick) < 0) {
+    return;
+  }
+  boolean due = isDue(fx, now) || transition;
+  for(int s = 1; s < numSegments; s++) {
+    due |= isDue(segments[s].fx, now);
+  }
+  for(int l = 0; l < numLayers; l++) {
+    due |= isDue(layers[l].fx, now);
+  }
+  if(!due) {
+    // Between frames the dithering goes on, at most at the frame rate
+    if(dithering && commit(now, true)) {
+      refreshes++;
+      nextTick = start + framePeriod;
+    }
+    return;
+  }
+
+  // All segments render into the one frame buffer. The outgoing effect
+  // keeps running in its own buffer until it is faded out completely;
+  // overlays render into theirs.
+  const Segment& main = segments[0];
+  if(transition) {
+    runEffect(outgoing, outgoingFrame, main, now);
+  }
+  for(int l = 0; l < numLayers; l++) {
+    runEffect(layers[l].fx, layers[l].frame, main, now);
+  }
+  for(int s = 1; s < numSegments; s++) {
+    runEffect(segments[s].fx, frame, segments[s], now);
+  }
+  if(isDue(fx, now)) {
+    setView(frame, main);
+    advance(now);
+  }
+  unsigned long rendered = micros();
+  frames++;
+  commit(now, true);
+  unsigned long shown = micros();
+
+  renderStats.add(rendered - start);
+  showStats.add(shown - rendered);
+  if(framePeriod > 0 && shown - start > framePeriod) {
+    overruns++;
+  }
+
+  nextTick += framePeriod;
+  if((long)(start - nextTick) > 0) {
+    nextTick = start;
+  }
+}
+
+boolean LED::isDue(const EffectState& state, unsigned long now) const {
+  return (long)(now - state.due) >= 0;
+}
+
+// Advance an effect other than the rotation on the segment's LEDs in
+// 'buffer'
+void LED::runEffect(EffectState& state, uint8_t* buffer, const Segment& segment, unsigned long now) {
+  if(!isDue(state, now)) {
+    return;
+  }
+  swapEffect(state);
+  swapped = true;
+  setView(buffer, segment);
+  advance(now);
+  swapped = false;
+  swapEffect(state);
+}
+
+// Point the drawing functions (setPixel, setAll, ...) at the segment's
+// LEDs in 'buffer'
+void LED::setView(uint8_t* buffer, const Segment& segment) {
+  pixels = &buffer[segment.start * 3];
+  viewStart = segment.start;
+  numLeds = segment.length;
+  grid = segment.layout;
+}
+
+// Render the next frame of the effect in 'fx' into 'pixels'
+void LED::advance(unsigned long now) {
+  int wait = render();
+
+  // Count the wait from when this frame was due, not from when it was
+  // done, so render and show time don't slow the effect down. When a frame
+  // comes later than its wait, the schedule starts over from now instead
+  // of rushing out the frames it is behind.
+  fx.due += wait;
+  if((long)(now - fx.due) > 0) {
+    fx.due = now;
+  }
+
+  if(!fx.done) {
+    fx.frame++;
+    return;
+  }
+  // Phase finished: continue with the next one or start the effect over
+  fx.done = false;
+  fx.frame = 0;
+  if(++fx.phase >= fx.phases) {
+    fx.phase = 0;
+    fx.phases = 1;
+  }
+}
+
+// Fresh state for a run of 'effect', with random numbers of its own
+void LED::startEffect(EffectState& state, int effect) {
+  state = EffectState();
+  state.effect = effect;
+  state.due = millis();
+  state.rng.seed(rng.next());
+}
+
+void LED::setSeed(uint32_t seed) {
+  rng.seed(seed);
+}
+
+// Exchange the rotation's effect state with another one
+void LED::swapEffect(EffectState& state) {
+  EffectState running = fx;
+  fx = state;
+  state = running;
+}
+
+// Run 'effect' on top of the running effect until the next effect change.
+// The layer is combined with what is below it according to 'mode'.
+boolean LED::addLayer(int effect, BlendMode mode, byte alpha) {
+  if(numLayers >= LED_LAYERS || effect < 0 || effect >= numEffects) {
+    return false;
+  }
+  Layer& layer = layers[numLayers++];
+  startEffect(layer.fx, effect);
+  layer.mode = mode;
+  layer.alpha = alpha;
+  memset(layer.frame, 0, totalLeds * 3);
+  return true;
+}
+
+void LED::clearLayers() {
+  if(numLayers > 0) {
+    numLayers = 0;
+    dirtyFrom = 0;
+    dirtyTo = totalLeds;
+  }
+}
+
+void LED::setInput(PixelInput* input) {
+  this->input = input;
+}
+
+void LED::setAudio(Audio* audio) {
+  this->audio = audio;
+}
+
+void LED::setSequence(Sequence* sequence) {
+  this->sequence = sequence;
+  if(sequence != nullptr) {
+    sequence->start(millis());
+  }
+}
+
+// Read the input into the segment running STREAM_INPUT, if there is one,
+// and show a completed frame right away rather than at the next tick.
+void LED::pollInput(unsigned long now) {
+  if(input == nullptr) {
+    return;
+  }
+  const Segment* target = nullptr;
+  if(fx.effect == STREAM_INPUT) {
+    target = &segments[0];
+  }
+  for(int s = 1; s < numSegments && target == nullptr; s++) {
+    if(segments[s].fx.effect == STREAM_INPUT) {
+      target = &segments[s];
+    }
+  }
+  if(target == nullptr) {
+    return;
+  }
+  int from, to;
+  if(input->poll(&frame[target->start * 3], target->length, from, to)) {
+    dirtyFrom = min(dirtyFrom, target->start + from);
+    dirtyTo = max(dirtyTo, target->start + to);
+    commit(now);
+  }
+}
+
+void LED::setTargetFps(int fps) {
+  framePeriod = fps > 0 ? 1000000UL / fps : 0;
+  nextTick = micros();
+}
+
+void LED::printStats(Print& out) {
+  out.print("render ");
+  out.print((long) renderStats.mean());
+  out.print("/");
+  out.print((long) renderStats.percentile(99));
+  out.print(" us, show ");
+  out.print((long) showStats.mean());
+  out.print("/");
+  out.print((long) showStats.percentile(99));
+  out.print(" us (mean/p99), overruns ");
+  out.print((long) overruns);
+  out.print(" of ");
+  out.print((long) framePeriod);
+  out.print(" us, power ");
+  out.print((long) estimatedMilliamps());
+  out.print(" mA at brightness ");
+  out.print((long) shownBrightness);
+  out.print(", dither refreshes ");
+  out.print((long) refreshes);
+  out.println();
+}
+
+// The effects of LED_EFFECT_LIST in led.h
+#define LED_EFFECT_INFO(id, name, frame, rotation, overlay, colors, budget) \
+  { name, [](LED& l) { return frame; }, rotation, overlay, colors },
+const LED::EffectInfo LED::effects[] = {
+  LED_EFFECT_LIST(LED_EFFECT_INFO)
+};
+#undef LED_EFFECT_INFO
+
+const int LED::numEffects = LED_EFFECTS;
+
+const char* LED::effectName(int effect) {
+  return effect >= 0 && effect < numEffects ? effects[effect].name : nullptr;
+}
+
+boolean LED::takesColors(int effect) {
+  return effect >= 0 && effect < numEffects && effects[effect].colors;
+}
+
+int LED::render() {
+  if(fx.frame == 0 && fx.phase == 0 && !fx.fixed) { // a new run starts
+    fx.red = fx.rng.below(255);
+    fx.green = fx.rng.below(255);
+    fx.blue = fx.rng.below(255);
+  }
+  if(fx.effect < 0 || fx.effect >= numEffects) {
+    // Only the rotation moves on, a segment or layer without an effect
+    // stays dark
+    if(swapped) {
+      fx.done = true;
+      return 1000;
+    }
+    nextEffect();
+    return 0;
+  }
+  return effects[fx.effect].step(*this);
+}
+
+void LED::setEffect(int effect) {
+  staticEffect = true;
+  effectColors = false;
+  this->effect = effect;
+  nextEffect();
+}
+
+void LED::setEffect(int effect, byte red, byte green, byte blue) {
+  staticEffect = true;
+  effectColors = true;
+  effectRed = red;
+  effectGreen = green;
+  effectBlue = blue;
+  this->effect = effect;
+  nextEffect();
 }
 
 void LED::nextEffect() {
   if(!staticEffect) {
+    // Only effects that are part of the rotation
     if(randomEffect) {
-      effect = random(numEffects);
+      do {
+        effect = rng.below(numEffects);
+      } while(!effects[effect].rotation);
     }
     else {
       effect++;
     }
   }
-  if(effect > numEffects ||
+  if(effect >= numEffects ||
+     (!staticEffect && !effects[effect].rotation) ||
      effect < 0) {
     if(!staticEffect) {
       effect = -1;
       nextEffect();
+      return;
     }
     else {
       effect = 0;
     }
   }
-  progress.setValue(effect);
+
+  // Fade over from the running effect; the new one starts on a copy of
+  // the current frame
+  if(transitionMs > 0 && fx.effect >= 0 && fx.effect != effect) {
+    outgoing = fx;
+    memcpy(outgoingFrame, frame, totalLeds * 3);
+    transition = true;
+    transitionStart = millis();
+  }
+  startEffect(fx, effect);
+  if(effectColors) {
+    fx.red = effectRed;
+    fx.green = effectGreen;
+    fx.blue = effectBlue;
+    fx.fixed = true;
+  }
+
+  clearLayers();
+  if(effects[effect].overlay >= 0) {
+    addLayer(effects[effect].overlay, BLEND_ADD, 255);
+  }
 }
 
 
@@ -113,468 +645,859 @@ void LED::nextEffect() {
 // (as a single 'packed' 32-bit value, which you can get by calling
 // strip->Color(red, green, blue) as shown in the loop() function above),
 // and a delay time (in milliseconds) between pixels.
-void LED::colorWipe(uint32_t color, int wait) {
-  for(int i=0; i<strip->numPixels(); i++) { // For each pixel in strip...
-    strip->setPixelColor(i, color);         //  Set pixel's color (in RAM)
-    strip->show();                          //  Update strip to match
-    delay(wait);                           //  Pause for a moment
-  }
+int LED::colorWipe(uint32_t color, int wait) {
+  int i = fx.frame;                      // One pixel per frame...
+  setPixel(i, color);                    //  Set pixel's color (in RAM)
+  fx.done = i+1 >= numPixels();
+  return wait;                           //  Pause for a moment
 }
 
 // Theater-marquee-style chasing lights. Pass in a color (32-bit value,
 // a la strip->Color(r,g,b) as mentioned above), and a delay time (in ms)
 // between frames.
-void LED::theaterChase(uint32_t color, int wait) {
-  for(int a=0; a<10; a++) {  // Repeat 10 times...
-    for(int b=0; b<3; b++) { //  'b' counts from 0 to 2...
-      strip->clear();         //   Set all pixels in RAM to 0 (off)
-      // 'c' counts up from 'b' to end of strip in steps of 3...
-      for(int c=b; c<strip->numPixels(); c += 3) {
-        strip->setPixelColor(c, color); // Set pixel 'c' to value 'color'
-      }
-      strip->show(); // Update strip with new contents
-      delay(wait);  // Pause for a moment
-    }
+int LED::theaterChase(uint32_t color, int wait) {
+  int b = fx.frame % 3;    // 'b' counts from 0 to 2, 10 times over
+  setAll(0,0,0);           //   Set all pixels in RAM to 0 (off)
+  // 'c' counts up from 'b' to end of strip in steps of 3...
+  for(int c=b; c<numPixels(); c += 3) {
+    setPixel(c, color);    // Set pixel 'c' to value 'color'
   }
+  fx.done = fx.frame+1 >= 10*3;
+  return wait;  // Pause for a moment
 }
 
 // Rainbow cycle along whole strip. Pass delay time (in ms) between frames.
-void LED::rainbow(int wait) {
+int LED::rainbow(int wait) {
   // Hue of first pixel runs 5 complete loops through the color wheel.
   // Color wheel has a range of 65536 but it's OK if we roll over, so
-  // just count from 0 to 5*65536. Adding 256 to firstPixelHue each time
-  // means we'll make 5*65536/256 = 1280 passes through this outer loop:
-  for(long firstPixelHue = 0; firstPixelHue < 5*65536; firstPixelHue += 256) {
-    for(int i=0; i<strip->numPixels(); i++) { // For each pixel in strip...
-      // Offset pixel hue by an amount to make one full revolution of the
-      // color wheel (range of 65536) along the length of the strip
-      // (strip->numPixels() steps):
-      int pixelHue = firstPixelHue + (i * 65536L / strip->numPixels());
-      // strip->ColorHSV() can take 1 or 3 arguments: a hue (0 to 65535) or
-      // optionally add saturation and value (brightness) (each 0 to 255).
-      // Here we're using just the single-argument hue variant. The result
-      // is passed through strip->gamma32() to provide 'truer' colors
-      // before assigning to each pixel:
-      strip->setPixelColor(i, strip->gamma32(strip->ColorHSV(pixelHue)));
-    }
-    strip->show(); // Update strip with new contents
-    delay(wait);  // Pause for a moment
+  // just count from 0 to 5*65536. Adding 256 to firstPixelHue each frame
+  // means we'll render 5*65536/256 = 1280 frames:
+  long firstPixelHue = fx.frame * 256;
+  for(int i=0; i<numPixels(); i++) { // For each pixel in strip...
+    // Offset pixel hue by an amount to make one full revolution of the
+    // color wheel (range of 65536) along the length of the strip
+    // (hueOffsets = i * 65536 / numPixels() per segment). The gamma corrected
+    // color for that hue comes straight from the precomputed hue ring:
+    const uint8_t* color = hueRing.hue(firstPixelHue + hueOffsets[viewStart + i]);
+    setPixel(i, color[0], color[1], color[2]);
   }
+  fx.done = firstPixelHue + 256 >= 5*65536;
+  return wait;  // Pause for a moment
 }
 
 // Rainbow-enhanced theater marquee. Pass delay time (in ms) between frames.
-void LED::theaterChaseRainbow(int wait) {
-  int firstPixelHue = 0;     // First pixel starts at red (hue 0)
-  for(int a=0; a<30; a++) {  // Repeat 30 times...
-    for(int b=0; b<3; b++) { //  'b' counts from 0 to 2...
-      strip->clear();         //   Set all pixels in RAM to 0 (off)
-      // 'c' counts up from 'b' to end of strip in increments of 3...
-      for(int c=b; c<strip->numPixels(); c += 3) {
-        // hue of pixel 'c' is offset by an amount to make one full
-        // revolution of the color wheel (range 65536) along the length
-        // of the strip (strip->numPixels() steps):
-        int      hue   = firstPixelHue + c * 65536L / strip->numPixels();
-        uint32_t color = strip->gamma32(strip->ColorHSV(hue)); // hue -> RGB
-        strip->setPixelColor(c, color); // Set pixel 'c' to value 'color'
-      }
-      strip->show();                // Update strip with new contents
-      delay(wait);                 // Pause for a moment
-      firstPixelHue += 65536 / 90; // One cycle of color wheel over 90 frames
-    }
+int LED::theaterChaseRainbow(int wait) {
+  // First pixel starts at red (hue 0), one cycle of color wheel over 90 frames
+  uint16_t firstPixelHue = fx.frame * (65536 / 90);
+  int b = fx.frame % 3;    // 'b' counts from 0 to 2, 30 times over
+  setAll(0,0,0);           //   Set all pixels in RAM to 0 (off)
+  // 'c' counts up from 'b' to end of strip in increments of 3...
+  for(int c=b; c<numPixels(); c += 3) {
+    // hue of pixel 'c' is offset by an amount to make one full
+    // revolution of the color wheel (range 65536) along the length
+    // of the strip, color looked up in the hue ring:
+    const uint8_t* color = hueRing.hue(firstPixelHue + hueOffsets[viewStart + c]);
+    setPixel(c, color[0], color[1], color[2]);
   }
+  fx.done = fx.frame+1 >= 30*3;
+  return wait;                  // Pause for a moment
 }
-void LED::RGBLoop(){
-  for(int j = 0; j < 3; j++ ) {
-    // Fade IN
-    for(int k = 0; k < 256; k++) {
-      switch(j) {
-        case 0: setAll(k,0,0); break;
-        case 1: setAll(0,k,0); break;
-        case 2: setAll(0,0,k); break;
-      }
-      strip->show();
-      delay(3);
-    }
-    // Fade OUT
-    for(int k = 255; k >= 0; k--) {
-      switch(j) {
-        case 0: setAll(k,0,0); break;
-        case 1: setAll(0,k,0); break;
-        case 2: setAll(0,0,k); break;
-      }
-      strip->show();
-      delay(3);
-    }
+
+int LED::RGBLoop(){
+  int j = fx.frame / 512;       // red, green, blue
+  int k = fx.frame % 512;       // fade in, then fade out
+  if(k > 255) {
+    k = 511 - k;
+  }
+  switch(j) {
+    case 0: setAll(k,0,0); break;
+    case 1: setAll(0,k,0); break;
+    case 2: setAll(0,0,k); break;
   }
+  fx.done = fx.frame+1 >= 3*512;
+  return 3;
 }
 
-void LED::FadeInOut(byte red, byte green, byte blue) {
+int LED::FadeInOut(byte red, byte green, byte blue) {
+  int k;
+
+  if(fx.frame < 256) {           // Fade IN
+    k = fx.frame;
+  }
+  else {                         // Fade OUT, twice as fast
+    k = 255 - 2*(fx.frame - 256);
+  }
+#if LED_FIXED_POINT
+  // k is the 8.8 scale factor, same result as the float version
+  setAll((k*red) >> 8, (k*green) >> 8, (k*blue) >> 8);
+#else
   float r, g, b;
+  r = (k/256.0)*red;
+  g = (k/256.0)*green;
+  b = (k/256.0)*blue;
+  setAll(r,g,b);
+#endif
 
-  for(int k = 0; k < 256; k=k+1) {
-    r = (k/256.0)*red;
-    g = (k/256.0)*green;
-    b = (k/256.0)*blue;
-    setAll(r,g,b);
-    strip->show();
-    delay(3);
-  }
-  delay(10);
-
-  for(int k = 255; k >= 0; k=k-2) {
-    r = (k/256.0)*red;
-    g = (k/256.0)*green;
-    b = (k/256.0)*blue;
-    setAll(r,g,b);
-    strip->show();
-    delay(3);
-  }
-}
-
-void LED::meteorRain(byte red, byte green, byte blue, byte meteorSize, byte meteorTrailDecay, boolean meteorRandomDecay, int SpeedDelay) {  
-  setAll(0,0,0);
-
-  int numLeds = strip->numPixels();
-  for(int i = 0; i < numLeds+numLeds; i++) {
-   
-   
-    // fade brightness all LEDs one step
-    for(int j=0; j<numLeds; j++) {
-      if( (!meteorRandomDecay) || (random(10)>5) ) {
-        fadeToBlack(j, meteorTrailDecay );        
-      }
-    }
-   
-    // draw meteor
-    for(int j = 0; j < meteorSize; j++) {
-      if( ( i-j <numLeds) && (i-j>=0) ) {
-        strip->setPixelColor(i-j, red, green, blue);
-      }
+  fx.done = k <= 1 && fx.frame >= 256;
+  return fx.frame == 255 ? 3 + 10 : 3;
+}
+
+int LED::meteorRain(byte red, byte green, byte blue, byte meteorSize, byte meteorTrailDecay, boolean meteorRandomDecay, int SpeedDelay) {
+  int numLeds = numPixels();
+  int i = fx.frame;
+  if(i == 0) {
+    setAll(0,0,0);
+  }
+
+  // fade brightness all LEDs one step
+  fadeToBlack(meteorTrailDecay, meteorRandomDecay);
+
+  // draw meteor
+  for(int j = 0; j < meteorSize; j++) {
+    if( ( i-j <numLeds) && (i-j>=0) ) {
+      setPixel(i-j, red, green, blue);
     }
-   
-    strip->show();
-    delay(SpeedDelay);
   }
+
+  fx.done = i+1 >= numLeds+numLeds;
+  return SpeedDelay;
 }
 
-void LED::Strobe(byte red, byte green, byte blue, int StrobeCount, int FlashDelay, int EndPause) {
-  for(int j = 0; j < StrobeCount; j++) {
+int LED::Strobe(byte red, byte green, byte blue, int StrobeCount, int FlashDelay, int EndPause) {
+  if(fx.frame >= (unsigned long) 2*StrobeCount) {
+    fx.done = true;
+    return EndPause;
+  }
+  if(fx.frame % 2 == 0) {
     setAll(red,green,blue);
-    strip->show();
-    delay(FlashDelay);
+  }
+  else {
     setAll(0,0,0);
-    strip->show();
-    delay(FlashDelay);
   }
- 
- delay(EndPause);
+
+  fx.done = fx.frame+1 >= (unsigned long) 2*StrobeCount;
+  return fx.done ? FlashDelay + EndPause : FlashDelay;
+}
+
+// Bursts of StrobeCount flashes with a random pause of up to MaxPause ms
+// before each, meant as an overlay on another effect
+int LED::StrobeBursts(byte red, byte green, byte blue, int StrobeCount, int FlashDelay, int MaxPause) {
+  fx.phases = 2;
+  if(fx.phase == 0) {
+    fx.done = true;
+    return fx.rng.below(MaxPause);
+  }
+  return Strobe(red, green, blue, StrobeCount, FlashDelay, 0);
 }
 
-void LED::HalloweenEyes(byte red, byte green, byte blue,
+int LED::HalloweenEyes(byte red, byte green, byte blue,
                    int EyeWidth, int EyeSpace,
                    boolean Fade, int Steps, int FadeDelay,
                    int EndPause) {
-  randomSeed(analogRead(0));
- 
   int i;
-  int StartPoint  = random( 0, strip->numPixels() - (2*EyeWidth) - EyeSpace );
+
+  if(fx.frame == 0) {
+    fx.pixel = fx.rng.range( 0, numPixels() - (2*EyeWidth) - EyeSpace );
+  }
+  int StartPoint  = fx.pixel;
   int Start2ndEye = StartPoint + EyeWidth + EyeSpace;
- 
-  for(i = 0; i < EyeWidth; i++) {
-    strip->setPixelColor(StartPoint + i, red, green, blue);
-    strip->setPixelColor(Start2ndEye + i, red, green, blue);
-  }
- 
-  strip->show();
- 
-  if(Fade==true) {
+
+  if(fx.frame == 0) {
+    for(i = 0; i < EyeWidth; i++) {
+      setPixel(StartPoint + i, red, green, blue);
+      setPixel(Start2ndEye + i, red, green, blue);
+    }
+
+    return 0;
+  }
+
+  if(Fade==true && fx.frame <= (unsigned long) Steps+1) {
     float r, g, b;
- 
-    for(int j = Steps; j >= 0; j--) {
-      r = j*(red/Steps);
-      g = j*(green/Steps);
-      b = j*(blue/Steps);
-     
-      for(i = 0; i < EyeWidth; i++) {
-        strip->setPixelColor(StartPoint + i, r, g, b);
-        strip->setPixelColor(Start2ndEye + i, r, g, b);
-      }
-     
-      strip->show();
-      delay(FadeDelay);
+    int j = Steps - (fx.frame - 1);
+
+    r = j*(red/Steps);
+    g = j*(green/Steps);
+    b = j*(blue/Steps);
+
+    for(i = 0; i < EyeWidth; i++) {
+      setPixel(StartPoint + i, r, g, b);
+      setPixel(Start2ndEye + i, r, g, b);
     }
+
+    return FadeDelay;
   }
- 
+
   setAll(0,0,0); // Set all black
- 
-  delay(EndPause);
+
+  fx.done = true;
+  return EndPause;
 }
 
-void LED::CylonBounce(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
-  int numLeds = strip->numPixels();
+int LED::CylonBounce(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
+  fx.phases = 2;
+  if(fx.phase == 0) {
+    return LeftToRight(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
+  }
+  return RightToLeft(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
+}
 
-  for(int i = 0; i < numLeds-EyeSize-2; i++) {
-    setAll(0,0,0);
-    strip->setPixelColor(i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(i+j, red, green, blue);
-    }
-    strip->setPixelColor(i+EyeSize+1, red/10, green/10, blue/10);
-    strip->show();
-    delay(SpeedDelay);
+int LED::NewKITT(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay){
+  fx.phases = 8;
+  switch(fx.phase) {
+    case 0: case 5: return RightToLeft(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
+    case 1: case 4: return LeftToRight(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
+    case 2: case 6: return OutsideToCenter(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
+    default:        return CenterToOutside(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
   }
+}
 
-  delay(ReturnDelay);
+int LED::CenterToOutside(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
+  int center = (numPixels()-EyeSize)/2;
+  return Scanner(red, green, blue, EyeSize, 1, center, 0, true, SpeedDelay, ReturnDelay);
+}
 
-  for(int i = numLeds-EyeSize-2; i > 0; i--) {
-    setAll(0,0,0);
-    strip->setPixelColor(i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(i+j, red, green, blue);
-    }
-    strip->setPixelColor(i+EyeSize+1, red/10, green/10, blue/10);
-    strip->show();
-    delay(SpeedDelay);
-  }
- 
-  delay(ReturnDelay);
+int LED::OutsideToCenter(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
+  int center = (numPixels()-EyeSize)/2;
+  return Scanner(red, green, blue, EyeSize, 1, 0, center, true, SpeedDelay, ReturnDelay);
 }
 
-void LED::NewKITT(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay){
-  RightToLeft(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  LeftToRight(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  OutsideToCenter(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  CenterToOutside(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  LeftToRight(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  RightToLeft(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  OutsideToCenter(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
-  CenterToOutside(red, green, blue, EyeSize, SpeedDelay, ReturnDelay);
+int LED::LeftToRight(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
+  return Scanner(red, green, blue, EyeSize, 1, 0, numPixels()-EyeSize-3, false, SpeedDelay, ReturnDelay);
 }
 
-void LED::CenterToOutside(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
-  int numLeds = strip->numPixels();
-  for(int i =((numLeds-EyeSize)/2); i>=0; i--) {
-    setAll(0,0,0);
-   
-    strip->setPixelColor(i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(i+j, red, green, blue);
-    }
-    strip->setPixelColor(i+EyeSize+1, red/10, green/10, blue/10);
-   
-    strip->setPixelColor(numLeds-i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(numLeds-i-j, red, green, blue);
-    }
-    strip->setPixelColor(numLeds-i-EyeSize-1, red/10, green/10, blue/10);
-   
-    strip->show();
-    delay(SpeedDelay);
+int LED::RightToLeft(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
+  return Scanner(red, green, blue, EyeSize, 1, numPixels()-EyeSize-2, 1, false, SpeedDelay, ReturnDelay);
+}
+
+// Level (of 256) of LED 't' of an eye: 'Falloff' LEDs fading in, 'EyeSize'
+// LEDs at full color, 'Falloff' LEDs fading out. The LED next to the eye
+// is at about 1/10.
+static uint16_t eyeLevel(int t, int EyeSize, int Falloff) {
+  if(t < 0 || t >= EyeSize + 2*Falloff) {
+    return 0;
   }
-  delay(ReturnDelay);
+  if(t < Falloff) {
+    return 26 * (t + 1) / Falloff;
+  }
+  if(t < Falloff + EyeSize) {
+    return 256;
+  }
+  return 26 * (EyeSize + 2*Falloff - t) / Falloff;
 }
 
-void LED::OutsideToCenter(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
-  int numLeds = strip->numPixels();
-  for(int i = 0; i<=((numLeds-EyeSize)/2); i++) {
-    setAll(0,0,0);
-   
-    strip->setPixelColor(i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(i+j, red, green, blue);
+// One sweep of an eye from LED 'from' to LED 'to' (where its first LED
+// is), with a second eye mirrored at the other end of the strip if
+// 'mirror' is set. The eye moves one LED per SpeedDelay ms. If frames come
+// faster than that it moves in fractions of an LED, spread over the two
+// LEDs it is between, so the motion stays smooth. Only the LEDs of the
+// last and the new eye are touched.
+int LED::Scanner(byte red, byte green, byte blue, int EyeSize, int Falloff,
+                 int from, int to, boolean mirror, int SpeedDelay, int ReturnDelay) {
+  if(from < 0 || to < 0) {
+    fx.done = true;
+    return ReturnDelay;
+  }
+  // Steps per LED: as many as frames fit into SpeedDelay, up to 16
+  int steps = 16;
+  if(framePeriod > 0) {
+    steps = constrain((long) SpeedDelay * 1000 / (long) framePeriod, 1L, 16L);
+  }
+  const int last = abs(to - from) * steps;
+  const int span = EyeSize + 2*Falloff + 1;
+  const int step = fx.frame * 256 / steps;
+  const int pos = from * 256 + (to >= from ? step : -step);
+
+  if(fx.pixel < 0) {
+    setAll(0,0,0); // first frame of the run
+  }
+  else {
+    // Take the last eye off
+    int first = fx.pixel >> 8;
+    for(int k = first; k < first + span; k++) {
+      setPixel(k, 0, 0, 0);
+      if(fx.variant) {
+        setPixel(numPixels() - k, 0, 0, 0);
+      }
     }
-    strip->setPixelColor(i+EyeSize+1, red/10, green/10, blue/10);
-   
-    strip->setPixelColor(numLeds-i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(numLeds-i-j, red, green, blue);
+  }
+
+  const int first = pos >> 8;
+  const uint16_t f = pos & 0xff;
+  for(int eye = 0; eye <= (mirror ? 1 : 0); eye++) {
+    for(int k = first; k < first + span; k++) {
+      uint16_t level = (eyeLevel(k - first, EyeSize, Falloff) * (256 - f) +
+                        eyeLevel(k - first - 1, EyeSize, Falloff) * f) >> 8;
+      if(level > 0) {
+        setPixel(eye ? numPixels() - k : k, (red * level) >> 8, (green * level) >> 8, (blue * level) >> 8);
+      }
     }
-    strip->setPixelColor(numLeds-i-EyeSize-1, red/10, green/10, blue/10);
-   
-    strip->show();
-    delay(SpeedDelay);
   }
-  delay(ReturnDelay);
+  fx.pixel = pos;
+  fx.variant = mirror;
+
+  fx.done = (int) fx.frame >= last;
+  // Spread SpeedDelay over the steps without losing the remainder
+  int wait = SpeedDelay * (int) (fx.frame % steps + 1) / steps - SpeedDelay * (int) (fx.frame % steps) / steps;
+  return fx.done ? wait + ReturnDelay : wait;
 }
 
-void LED::LeftToRight(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
-  int numLeds = strip->numPixels();
-  for(int i = 0; i < numLeds-EyeSize-2; i++) {
+int LED::Twinkle(byte red, byte green, byte blue, int Count, int SpeedDelay, boolean OnlyOne) {
+  if(fx.frame == 0) {
+    setAll(0,0,0);
+  }
+
+  setPixel(fx.rng.below(numPixels()),red,green,blue);
+  if(OnlyOne) {
     setAll(0,0,0);
-    strip->setPixelColor(i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(i+j, red, green, blue);
-    }
-    strip->setPixelColor(i+EyeSize+1, red/10, green/10, blue/10);
-    strip->show();
-    delay(SpeedDelay);
   }
-  delay(ReturnDelay);
+
+  fx.done = fx.frame+1 >= (unsigned long) Count;
+  return fx.done ? SpeedDelay + SpeedDelay : SpeedDelay;
 }
 
-void LED::RightToLeft(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay) {
-  int numLeds = strip->numPixels();
-  for(int i = numLeds-EyeSize-2; i > 0; i--) {
+int LED::TwinkleRandom(int Count, int SpeedDelay, boolean OnlyOne) {
+  if(fx.frame == 0) {
     setAll(0,0,0);
-    strip->setPixelColor(i, red/10, green/10, blue/10);
-    for(int j = 1; j <= EyeSize; j++) {
-      strip->setPixelColor(i+j, red, green, blue);
-    }
-    strip->setPixelColor(i+EyeSize+1, red/10, green/10, blue/10);
-    strip->show();
-    delay(SpeedDelay);
-  }
-  delay(ReturnDelay);
-}
-
-void LED::Twinkle(byte red, byte green, byte blue, int Count, int SpeedDelay, boolean OnlyOne) {
-  setAll(0,0,0);
- 
-  for (int i=0; i<Count; i++) {
-     strip->setPixelColor(random(strip->numPixels()),red,green,blue);
-     strip->show();
-     delay(SpeedDelay);
-     if(OnlyOne) {
-       setAll(0,0,0);
-     }
-   }
- 
-  delay(SpeedDelay);
-}
-
-void LED::TwinkleRandom(int Count, int SpeedDelay, boolean OnlyOne) {
-  setAll(0,0,0);
- 
-  for (int i=0; i<Count; i++) {
-     strip->setPixelColor(random(strip->numPixels()),random(0,255),random(0,255),random(0,255));
-     strip->show();
-     delay(SpeedDelay);
-     if(OnlyOne) {
-       setAll(0,0,0);
-     }
-   }
- 
-  delay(SpeedDelay);
-}
-
-void LED::Sparkle(byte red, byte green, byte blue, int SpeedDelay) {
-  int Pixel = random(strip->numPixels());
-  strip->setPixelColor(Pixel,red,green,blue);
-  strip->show();
-  delay(SpeedDelay);
-  strip->setPixelColor(Pixel,0,0,0);
-}
-
-void LED::SnowSparkle(byte red, byte green, byte blue, int SparkleDelay, int SpeedDelay) {
-  setAll(red,green,blue);
- 
-  int Pixel = random(strip->numPixels());
-  strip->setPixelColor(Pixel,0xff,0xff,0xff);
-  strip->show();
-  delay(SparkleDelay);
-  strip->setPixelColor(Pixel,red,green,blue);
-  strip->show();
-  delay(SpeedDelay);
-}
-
-void LED::RunningLights(byte red, byte green, byte blue, int WaveDelay) {
-  int Position=0;
-  int numLeds = strip->numPixels();
- 
-  for(int j=0; j<numLeds*2; j++)
-  {
-      Position++; // = 0; //Position + Rate;
-      for(int i=0; i<numLeds; i++) {
-        // sine wave, 3 offset waves make a rainbow!
-        //float level = sin(i+Position) * 127 + 128;
-        //setPixel(i,level,0,0);
-        //float level = sin(i+Position) * 127 + 128;
-        strip->setPixelColor(i,((sin(i+Position) * 127 + 128)/255)*red,
-                               ((sin(i+Position) * 127 + 128)/255)*green,
-                               ((sin(i+Position) * 127 + 128)/255)*blue);
+  }
+
+  uint32_t color = fx.rng.next();
+  setPixel(fx.rng.below(numPixels()),color % 255,(color >> 8) % 255,(color >> 16) % 255);
+  if(OnlyOne) {
+    setAll(0,0,0);
+  }
+
+  fx.done = fx.frame+1 >= (unsigned long) Count;
+  return fx.done ? SpeedDelay + SpeedDelay : SpeedDelay;
+}
+
+int LED::Sparkle(byte red, byte green, byte blue, int SpeedDelay) {
+  if(fx.pixel >= 0) {
+    setPixel(fx.pixel,0,0,0);
+  }
+  fx.pixel = fx.rng.below(numPixels());
+  setPixel(fx.pixel,red,green,blue);
+  fx.done = true;
+  return SpeedDelay;
+}
+
+int LED::SnowSparkle(byte red, byte green, byte blue, int SparkleDelay, int SpeedDelay) {
+  if(fx.frame == 0) {
+    setAll(red,green,blue);
+
+    fx.pixel = fx.rng.below(numPixels());
+    setPixel(fx.pixel,0xff,0xff,0xff);
+    return SparkleDelay;
+  }
+  setPixel(fx.pixel,red,green,blue);
+  fx.done = true;
+  return SpeedDelay;
+}
+
+int LED::RunningLights(byte red, byte green, byte blue, int WaveDelay) {
+  int Position = fx.frame + 1;
+  int numLeds = numPixels();
+
+  for(int i=0; i<numLeds; i++) {
+    // sine wave, 3 offset waves make a rainbow!
+#if LED_FIXED_POINT
+    uint8_t phase = ((i+Position) * SINE8_PER_RADIAN) >> 8;
+    uint16_t level = pgm_read_byte(&sine8[phase]) + 1; // 8.8, 256 = 1.0
+    setPixel(i, (level*red) >> 8, (level*green) >> 8, (level*blue) >> 8);
+#else
+    //float level = sin(i+Position) * 127 + 128;
+    //setPixel(i,level,0,0);
+    //float level = sin(i+Position) * 127 + 128;
+    setPixel(i,((sin(i+Position) * 127 + 128)/255)*red,
+               ((sin(i+Position) * 127 + 128)/255)*green,
+               ((sin(i+Position) * 127 + 128)/255)*blue);
+#endif
+  }
+
+  fx.done = Position >= numLeds*2;
+  return WaveDelay;
+}
+
+// The input writes its frames into the segment between frames (see
+// pollInput()), there is nothing to render here.
+int LED::StreamInput() {
+  return 100;
+}
+
+// One bar per audio band side by side, as long as the band is loud, each
+// in its own color of the rainbow
+int LED::SpectrumBars(int SpeedDelay) {
+  const uint8_t* bands = audio != nullptr ? audio->bands() : nullptr;
+  for(int b = 0; b < AUDIO_BANDS; b++) {
+    const int from = numPixels() * b / AUDIO_BANDS;
+    const int to = numPixels() * (b + 1) / AUDIO_BANDS;
+    const int lit = bands != nullptr ? from + (to - from) * bands[b] / 255 : from;
+    const uint8_t* color = hueRing.color(b * 256 / AUDIO_BANDS);
+    for(int i = from; i < to; i++) {
+      if(i < lit) {
+        setPixel(i, color[0], color[1], color[2]);
+      }
+      else {
+        setPixel(i, 0, 0, 0);
       }
-     
-      strip->show();
-      delay(WaveDelay);
+    }
   }
+  return SpeedDelay;
 }
 
-void LED::Fire(int Cooling, int Sparking, int SpeedDelay) {
-  const int numLeds = strip->numPixels();
-  byte heat[numLeds];
+// Light the whole strip, or one LED in eight at random with 'sparkle', on
+// every beat and let it fade out until the next one
+int LED::BeatFlash(byte red, byte green, byte blue, boolean sparkle, int SpeedDelay) {
+  const int beats = audio != nullptr ? audio->beats() : 0;
+  if(fx.frame == 0) {
+    fx.pixel = beats;
+  }
+  if(beats == fx.pixel) {
+    fadeToBlack(64, false);
+    return SpeedDelay;
+  }
+  fx.pixel = beats;
+  if(!sparkle) {
+    setAll(red, green, blue);
+    return SpeedDelay;
+  }
+  for(int n = numPixels() / 8; n >= 0; n--) {
+    setPixel(fx.rng.below(numPixels()), red, green, blue);
+  }
+  return SpeedDelay;
+}
+
+// Fire on 'Zones' equally long parts of the strip, each with its own flame
+// burning from the start of its part towards the end. The heat of every
+// cell lives in 'heat' and carries over from frame to frame.
+int LED::Fire(int Cooling, int Sparking, int SpeedDelay, int Zones) {
+  byte* heat = &this->heat[viewStart];
+  if(fx.frame == 0) {
+    memset(heat, 0, numPixels());
+  }
+  const int zoneLeds = numPixels() / Zones;
+  for(int zone = 0; zone < Zones; zone++) {
+    const int numLeds = zone == Zones-1 ? numPixels() - zone * zoneLeds : zoneLeds;
+    burn(&heat[zone * zoneLeds], numLeds, Cooling, Sparking);
+  }
+
+  // Step 4.  Convert heat to LED colors
+  for( int j = 0; j < numPixels(); j++) {
+    setPixelHeatColor(j, heat[j] );
+  }
+
+  return SpeedDelay;
+}
+
+// One step of a flame: 'numLeds' heat cells from the bottom up
+void LED::burn(byte* cell, int numLeds, int Cooling, int Sparking) {
   int cooldown;
- 
+
   // Step 1.  Cool down every cell a little
   for( int i = 0; i < numLeds; i++) {
-    cooldown = random(0, ((Cooling * 10) / numLeds) + 2);
-   
-    if(cooldown>heat[i]) {
-      heat[i]=0;
+    cooldown = fx.rng.below(((Cooling * 10) / numLeds) + 2);
+
+    if(cooldown>cell[i]) {
+      cell[i]=0;
     } else {
-      heat[i]=heat[i]-cooldown;
+      cell[i]=cell[i]-cooldown;
     }
   }
- 
+
   // Step 2.  Heat from each cell drifts 'up' and diffuses a little
   for( int k= numLeds - 1; k >= 2; k--) {
-    heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2]) / 3;
+    cell[k] = (cell[k - 1] + cell[k - 2] + cell[k - 2]) / 3;
   }
-   
+
   // Step 3.  Randomly ignite new 'sparks' near the bottom
-  if( random(255) < Sparking ) {
-    int y = random(7);
-    heat[y] = heat[y] + random(160,255);
-    //heat[y] = random(160,255);
+  if( (int) fx.rng.below(255) < Sparking ) {
+    int y = fx.rng.below(min(7, numLeds));
+    cell[y] = min(255, cell[y] + (int) fx.rng.range(160,255));
   }
+}
 
-  // Step 4.  Convert heat to LED colors
-  for( int j = 0; j < numLeds; j++) {
-    setPixelHeatColor(j, heat[j] );
+// 2D versions of rainbow, Fire and RunningLights for a segment with a
+// layout; they draw row by row through the layout's index table. Without
+// a layout they are the strip versions.
+
+// The rainbow runs diagonally across the matrix
+int LED::rainbow2D(int wait) {
+  if(grid == nullptr) {
+    return rainbow(wait);
   }
+  const long firstPixelHue = fx.frame * 256;
+  const uint16_t dx = 65536L / grid->width;
+  const uint16_t dy = 65536L / grid->height;
+  for(int y = 0; y < grid->height; y++) {
+    const uint16_t* row = grid->row(y);
+    uint16_t hue = firstPixelHue + y * dy;
+    for(int x = 0; x < grid->width; x++, hue += dx) {
+      const uint8_t* color = hueRing.hue(hue);
+      setPixel(row[x], color[0], color[1], color[2]);
+    }
+  }
+  fx.done = firstPixelHue + 256 >= 5*65536;
+  return wait;
+}
 
-  strip->show();
-  delay(SpeedDelay);
+// A flame in every column, burning from the bottom row up
+int LED::Fire2D(int Cooling, int Sparking, int SpeedDelay) {
+  if(grid == nullptr) {
+    return Fire(Cooling, Sparking, SpeedDelay, 1 + numPixels() / 150);
+  }
+  const int w = grid->width, h = grid->height;
+  byte* heat = &this->heat[viewStart]; // column by column, bottom first
+  if(fx.frame == 0) {
+    memset(heat, 0, numPixels());
+  }
+  for(int x = 0; x < w; x++) {
+    burn(&heat[x * h], h, Cooling, Sparking);
+  }
+  for(int y = 0; y < h; y++) {
+    const uint16_t* row = grid->row(y);
+    for(int x = 0; x < w; x++) {
+      setPixelHeatColor(row[x], heat[x * h + h - 1 - y]);
+    }
+  }
+  return SpeedDelay;
+}
+
+// The waves roll down the rows
+int LED::RunningLights2D(byte red, byte green, byte blue, int WaveDelay) {
+  if(grid == nullptr) {
+    return RunningLights(red, green, blue, WaveDelay);
+  }
+  const int Position = fx.frame + 1;
+  for(int y = 0; y < grid->height; y++) {
+    const uint16_t* row = grid->row(y);
+#if LED_FIXED_POINT
+    uint8_t phase = ((Position - y) * SINE8_PER_RADIAN) >> 8;
+    uint16_t level = pgm_read_byte(&sine8[phase]) + 1; // 8.8, 256 = 1.0
+#else
+    uint16_t level = (sin(Position - y) * 127 + 128) + 1;
+#endif
+    const byte r = (level*red) >> 8, g = (level*green) >> 8, b = (level*blue) >> 8;
+    for(int x = 0; x < grid->width; x++) {
+      setPixel(row[x], r, g, b);
+    }
+  }
+  fx.done = Position >= grid->height*2;
+  return WaveDelay;
 }
 
 void LED::setPixelHeatColor (int Pixel, byte temperature) {
-  // Scale 'heat' down from 0-255 to 0-191
-  byte t192 = round((temperature/255.0)*191);
- 
-  // calculate ramp up from
-  byte heatramp = t192 & 0x3F; // 0..63
-  heatramp <<= 2; // scale up to 0..252
- 
-  // figure out which third of the spectrum we're in:
-  if( t192 > 0x80) {                     // hottest
-    strip->setPixelColor(Pixel, 255, 255, heatramp);
-  } else if( t192 > 0x40 ) {             // middle
-    strip->setPixelColor(Pixel, 255, heatramp, 0);
-  } else {                               // coolest
-    strip->setPixelColor(Pixel, heatramp, 0, 0);
-  }
-}
-
-void LED::fadeToBlack(int ledNo, byte fadeValue) {
-  // NeoPixel
-  uint32_t oldColor;
-  uint8_t r, g, b;
-  int value;
- 
-  oldColor = strip->getPixelColor(ledNo);
-  r = (oldColor & 0x00ff0000UL) >> 16;
-  g = (oldColor & 0x0000ff00UL) >> 8;
-  b = (oldColor & 0x000000ffUL);
-
-  r=(r<=10)? 0 : (int) r-(r*fadeValue/256);
-  g=(g<=10)? 0 : (int) g-(g*fadeValue/256);
-  b=(b<=10)? 0 : (int) b-(b*fadeValue/256);
- 
-  strip->setPixelColor(ledNo, r,g,b);
+  const uint8_t* color = heatColors[temperature];
+  setPixel(Pixel, pgm_read_byte(&color[0]), pgm_read_byte(&color[1]), pgm_read_byte(&color[2]));
+}
+
+// Fade the whole frame one step towards black. With randomDecay only
+// about 4 in 10 pixels fade, like the per pixel random(10)>5 test of the
+// original meteor. The work is done in blocks of FADE_BLOCK pixels: first
+// one random byte per pixel (filled in one go) decides whether it fades and
+// goes into a per byte mask, then one branch free loop over the raw bytes
+// fades them (and vectorizes on the host).
+#define FADE_BLOCK 32
+
+void LED::fadeToBlack(byte fadeValue, boolean randomDecay) {
+  uint8_t mask[FADE_BLOCK * 3];
+  uint8_t dice[FADE_BLOCK];
+  uint8_t changed = 0;
+
+  memset(mask, 0xff, sizeof(mask));
+  for(int first = 0; first < numLeds; first += FADE_BLOCK) {
+    const int count = min(FADE_BLOCK, numLeds - first) * 3;
+    uint8_t* p = &pixels[first * 3];
+
+    if(randomDecay) {
+      fx.rng.fill(dice, count / 3);
+      for(int i = 0; i < count; i += 3) {
+        uint8_t m = dice[i / 3] < 102 ? 0xff : 0x00; // 102/256 ~ 4/10
+        mask[i] = mask[i+1] = mask[i+2] = m;
+      }
+    }
+    for(int i = 0; i < count; i++) {
+      uint8_t v = p[i];
+      uint8_t faded = v <= 10 ? 0 : v - ((v * fadeValue) >> 8);
+      uint8_t result = (faded & mask[i]) | (v & ~mask[i]);
+      changed |= result ^ v;
+      p[i] = result;
+    }
+  }
+
+  if(changed) {
+    dirtyFrom = min(dirtyFrom, viewStart);
+    dirtyTo = max(dirtyTo, viewStart + numLeds);
+  }
 }
 
 void LED::setAll(byte red, byte green, byte blue) {
-  for(int i = 0; i < strip->numPixels(); i++ ) {
-    strip->setPixelColor(i, strip->Color(red, green, blue));
+  for(int i = 0; i < numLeds; i++ ) {
+    setPixel(i, red, green, blue);
+  }
+}
+
+// Effects draw into 'pixels'; only pixels that really change are marked,
+// so a frame that repaints the same picture costs no strip update.
+void LED::setPixel(int n, byte red, byte green, byte blue) {
+  if(n < 0 || n >= numLeds) {
+    return;
+  }
+  uint8_t* p = &pixels[n * 3];
+  if(p[0] == red && p[1] == green && p[2] == blue) {
+    return;
+  }
+  p[0] = red;
+  p[1] = green;
+  p[2] = blue;
+  n += viewStart;
+  if(n < dirtyFrom) {
+    dirtyFrom = n;
+  }
+  if(n >= dirtyTo) {
+    dirtyTo = n + 1;
+  }
+}
+
+void LED::setPixel(int n, uint32_t color) {
+  setPixel(n, (byte)(color >> 16), (byte)(color >> 8), (byte)color);
+}
+
+uint32_t LED::getPixel(int n) const {
+  if(n < 0 || n >= numLeds) {
+    return 0;
+  }
+  const uint8_t* p = &pixels[n * 3];
+  return PixelSink::Color(p[0], p[1], p[2]);
+}
+
+// End of a frame: hand the changed pixels to the sinks and show each of
+// them once. Nothing is sent if the frame did not change anything. While a
+// transition runs, every pixel of the rotation's segment is blended from
+// the outgoing and the running effect. 'tick' is set at the frame rate,
+// see below. Returns whether any output was shown.
+boolean LED::commit(unsigned long now, boolean tick) {
+  const Segment& main = segments[0];
+  uint16_t alpha = 256;
+  if(transition) {
+    alpha = transitionMs > 0 ? min(256UL, (now - transitionStart) * 256 / transitionMs) : 256;
+    transition = alpha < 256;
+    dirtyFrom = min(dirtyFrom, main.start);
+    dirtyTo = max(dirtyTo, main.start + main.length);
   }
-  strip->show();
+  // An output still sending its last frame keeps its changes until the
+  // next commit; the others go out now. On a tick the outputs without
+  // changes but with LEDs between two levels are shown as well.
+  boolean ready[LED_OUTPUTS];
+  int sentFrom[LED_OUTPUTS];
+  int sentTo[LED_OUTPUTS];
+  pending = false;
+  for(int o = 0; o < numOutputs; o++) {
+    ready[o] = false;
+    sentFrom[o] = sentTo[o] = outputStart[o];
+    int from = min(max(dirtyFrom, outputStart[o]), pendingFrom[o]);
+    int to = max(min(dirtyTo, outputStart[o] + outputs[o]->numPixels()), pendingTo[o]);
+    if(from >= to) {
+      ready[o] = tick && dithering && grain[o] > 0 && canShow(o);
+      continue;
+    }
+    if(!canShow(o)) {
+      pendingFrom[o] = from;
+      pendingTo[o] = to;
+      pending = true;
+      continue;
+    }
+    composite(o, from, to, alpha);
+    ready[o] = true;
+    sentFrom[o] = from;
+    sentTo[o] = to;
+    pendingFrom[o] = totalLeds;
+    pendingTo[o] = 0;
+  }
+
+  // Dim the frame to the power budget before it is shown. All pixels are
+  // scaled again with a new brightness.
+  byte limited = limitedBrightness();
+  if(limited != shownBrightness) {
+    shownBrightness = limited;
+    for(int o = 0; o < numOutputs; o++) {
+      int from = outputStart[o];
+      int to = from + outputs[o]->numPixels();
+      if(ready[o] || canShow(o)) {
+        composite(o, from, to, alpha);
+        ready[o] = true;
+        sentFrom[o] = from;
+        sentTo[o] = to;
+      }
+      else {
+        pendingFrom[o] = from;
+        pendingTo[o] = to;
+        pending = true;
+      }
+    }
+  }
+  // The LEDs left as they were take their next dithering step with them
+  boolean shown = false;
+  for(int o = 0; o < numOutputs; o++) {
+    if(ready[o]) {
+      dither(o, outputStart[o], sentFrom[o]);
+      dither(o, sentTo[o], outputStart[o] + outputs[o]->numPixels());
+      outputs[o]->show();
+      shown = true;
+    }
+  }
+  dirtyFrom = totalLeds;
+  dirtyTo = 0;
+  return shown;
+}
+
+// Combine running effect, outgoing effect (alpha/256 of the running one)
+// and the layers in one pass over the pixels and send the result to
+// output 'o'. Transition and layers only cover the rotation's segment.
+// Blending is done in 8.8 fixed point, so a crossfade or a layer at low
+// alpha keeps its fractions for the dithering.
+void LED::composite(int o, int from, int to, uint16_t alpha) {
+  const uint16_t beta = 256 - alpha;
+  const int mainFrom = segments[0].start;
+  const int mainTo = mainFrom + segments[0].length;
+
+  for(int i = from; i < to; i++) {
+    const uint8_t* p = &frame[i * 3];
+    uint32_t r = p[0] << 8, g = p[1] << 8, b = p[2] << 8;
+
+    if(i < mainFrom || i >= mainTo) {
+      send(o, i, r, g, b);
+      continue;
+    }
+    if(alpha < 256) {
+      const uint8_t* q = &outgoingFrame[i * 3];
+      r = p[0] * alpha + q[0] * beta;
+      g = p[1] * alpha + q[1] * beta;
+      b = p[2] * alpha + q[2] * beta;
+    }
+    for(int l = 0; l < numLayers; l++) {
+      const Layer& layer = layers[l];
+      const uint8_t* q = &layer.frame[i * 3];
+      const uint16_t a = layer.alpha + (layer.alpha >> 7); // 0 to 256
+      switch(layer.mode) {
+        case BLEND_ALPHA:
+          r = q[0] * a + ((r * (256 - a)) >> 8);
+          g = q[1] * a + ((g * (256 - a)) >> 8);
+          b = q[2] * a + ((b * (256 - a)) >> 8);
+          break;
+        case BLEND_ADD:
+          r = min((uint32_t) 65280, r + q[0] * a);
+          g = min((uint32_t) 65280, g + q[1] * a);
+          b = min((uint32_t) 65280, b + q[2] * a);
+          break;
+        // These two go alpha of the way from the pixels below to the blend
+        case BLEND_MAX:
+          r += ((max(r, (uint32_t) q[0] << 8) - r) * a) >> 8;
+          g += ((max(g, (uint32_t) q[1] << 8) - g) * a) >> 8;
+          b += ((max(b, (uint32_t) q[2] << 8) - b) * a) >> 8;
+          break;
+        case BLEND_MULTIPLY:
+          r -= ((r - ((r * (q[0] + 1)) >> 8)) * a) >> 8;
+          g -= ((g - ((g * (q[1] + 1)) >> 8)) * a) >> 8;
+          b -= ((b - ((b * (q[2] + 1)) >> 8)) * a) >> 8;
+          break;
+      }
+    }
+    send(o, i, r, g, b);
+  }
+}
+
+// Whether output 'o' can take a frame now. One that sends with the
+// interrupts off waits for the audio block being sampled, which it would
+// otherwise cut short.
+boolean LED::canShow(int o) {
+  if(audio != nullptr && outputs[o]->blocksInterrupts() && audio->sampling()) {
+    return false;
+  }
+  return outputs[o]->canShow();
+}
+
+// Hand one pixel (8.8 levels) to its output: keep the sum of all channels,
+// the base of the current estimate, up to date, scale it to the brightness
+// and keep count of the LEDs left with a fraction
+void LED::send(int o, int i, uint16_t r, uint16_t g, uint16_t b) {
+  const uint16_t level = ((uint32_t) r + g + b) >> 8;
+  load += level - levels[i];
+  levels[i] = level;
+
+  // 255 scales by exactly 1.0 (65536)
+  const uint32_t scale = shownBrightness * 257 + (shownBrightness >> 7);
+  uint16_t* w = &wide[i * 3];
+  const int grainy = ((w[0] | w[1] | w[2]) & 0xff) != 0;
+  w[0] = (r * scale) >> 16;
+  w[1] = (g * scale) >> 16;
+  w[2] = (b * scale) >> 16;
+  grain[o] += (((w[0] | w[1] | w[2]) & 0xff) != 0) - grainy;
+  push(o, i);
+}
+
+// Set one LED of output 'o' from its 16 bit levels: the next step of the
+// dithering, or rounded without it
+void LED::push(int o, int i) {
+  const uint16_t* w = &wide[i * 3];
+  uint8_t* e = &residual[i * 3];
+  uint8_t c[3];
+  for(int k = 0; k < 3; k++) {
+    if(dithering) {
+      const uint16_t v = w[k] + e[k];
+      c[k] = v >> 8;
+      e[k] = v;
+    }
+    else {
+      c[k] = (w[k] + 128) >> 8;
+    }
+  }
+  outputs[o]->setPixelColor(i - outputStart[o], c[0], c[1], c[2]);
+}
+
+// Push the LEDs with fractional levels in 'from' to 'to' of output 'o'
+// once more, with the next step of their dithering
+void LED::dither(int o, int from, int to) {
+  if(!dithering || grain[o] == 0) {
+    return;
+  }
+  for(int i = from; i < to; i++) {
+    const uint16_t* w = &wide[i * 3];
+    if((w[0] | w[1] | w[2]) & 0xff) {
+      push(o, i);
+    }
+  }
+}
+
+// Current (mA) the LEDs draw at the given brightness: each channel takes up
+// to LED_MA_PER_CHANNEL, each LED LED_MA_IDLE when dark
+unsigned long LED::milliamps(byte brightness) const {
+  return (unsigned long) totalLeds * LED_MA_IDLE + load * LED_MA_PER_CHANNEL / 255 * brightness / 255;
+}
+
+// The brightness, or less if the LEDs would draw more than the budget at it
+byte LED::limitedBrightness() const {
+  unsigned long draw = milliamps(brightness);
+  if(powerBudget == 0 || draw <= powerBudget) {
+    return brightness;
+  }
+  unsigned long idle = (unsigned long) totalLeds * LED_MA_IDLE;
+  if(powerBudget <= idle) {
+    return 0;
+  }
+  return (powerBudget - idle) * brightness / (draw - idle);
+}
+
+boolean LED::checkLoad() const {
+  unsigned long sum = 0;
+  for(int i = 0; i < totalLeds; i++) {
+    sum += levels[i];
+  }
+  return sum == load;
+}
+
+void LED::setPowerBudget(unsigned long milliamps) {
+  powerBudget = milliamps;
+}
+
+unsigned long LED::estimatedMilliamps() const {
+  return milliamps(shownBrightness);
 }
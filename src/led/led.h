@@ -1,58 +1,429 @@
 #ifndef __LED_H__
 #define __LED_H__
 
-#include <Adafruit_NeoPixel.h>
+#include "pixelsink.h"
+#include "palette.h"
+#include "framestats.h"
+#include "pixelinput.h"
+#include "rng.h"
+#include "audio.h"
+#include "layout.h"
+#include "sequence.h"
+#include "display.h"
+
+// Integer-only effect kernels (sine table, 8.8 scaling) instead of float
+// math; the ESP8266 has no FPU. Build with LED_FIXED_POINT=0 for the
+// original float versions.
+#ifndef LED_FIXED_POINT
+#define LED_FIXED_POINT 1
+#endif
+
+// Nextion display: poll for touch events every NEXTION_POLL_MS, send
+// updates to it at most every NEXTION_UPDATE_MS
+#define NEXTION_POLL_MS    10
+#define NEXTION_UPDATE_MS 250
+
+// Frame rate limit, effects can render slower but not faster (0 = no limit)
+#ifndef LED_TARGET_FPS
+#define LED_TARGET_FPS 100
+#endif
+
+// Seed of the effect rotation and of every effect's random numbers. The
+// same seed gives the same sequence of effects and frames.
+#ifndef LED_SEED
+#define LED_SEED 326874522UL
+#endif
+
+// Crossfade time (ms) from one effect to the next (0 = switch right away)
+#ifndef LED_TRANSITION_MS
+#define LED_TRANSITION_MS 1000
+#endif
+
+// Number of layers that can run on top of the effect
+#ifndef LED_LAYERS
+#define LED_LAYERS 2
+#endif
+
+// Strips (outputs) one LED instance can drive and segments it can split
+// them into
+#ifndef LED_OUTPUTS
+#define LED_OUTPUTS 4
+#endif
+#ifndef LED_SEGMENTS
+#define LED_SEGMENTS 4
+#endif
+
+// Buffer bytes LED needs for 'leds' LEDs: the rainbow hue offsets and the
+// power levels (2 per LED each), the 16 bit output levels (6), the frame,
+// the outgoing frame and the layers (3 each), Fire's heat (1) and the
+// dithering residuals (3)
+#define LED_BUFFER_SIZE(leds) ((leds) * (10 + 3 * (2 + LED_LAYERS) + 1 + 3))
+
+// Current model of a WS2812 LED for the power budget: mA per color channel
+// at full level and of a dark LED
+#ifndef LED_MA_PER_CHANNEL
+#define LED_MA_PER_CHANNEL 20
+#endif
+#ifndef LED_MA_IDLE
+#define LED_MA_IDLE 1
+#endif
+
+// All effects, by effect number, and the only place they are listed: the
+// effect ids, LED::effects and the names all come from here. Adding an
+// effect takes one entry
+//   X(id, name, frame, rotation, overlay, colors, budget)
+// with 'frame' rendering one frame of it on LED 'l' (with its parameters)
+// and returning the wait in ms, whether it runs in the rotation, the
+// overlay layered on top of it while it runs (-1 for none), whether it
+// draws in the colors of setEffect(effect, red, green, blue) and the time
+// per LED the ledbench host tool allows it, in steps of its calibration
+// loop.
+//
+// Outside the rotation:
+//   OVERLAY_STROBE     only makes sense as a layer
+//   STREAM_INPUT       shows the pixels from the input attached with setInput()
+//   AUDIO_METEOR       meteorRain, faster when louder   } follow the music
+//   AUDIO_SPECTRUM     one bar per band                 } from the Audio
+//   AUDIO_STROBE       flash on every beat              } attached with
+//   AUDIO_SPARKLE      sparkles on every beat           } setAudio()
+//   RAINBOW_2D, FIRE_2D, RUNNING_LIGHTS_2D
+//                      on the segment's layout set with setLayout(), as on
+//                      a strip without one
+#define LED_EFFECT_LIST(X) \
+  X(SNOW_SPARKLE,   "SnowSparkle",   l.SnowSparkle(l.fixedRed(0x10), l.fixedGreen(0x10), l.fixedBlue(0x10), 20, 200), true, -1, true, 22) \
+  X(SPARKLE,        "Sparkle",       l.Sparkle(l.fx.red, l.fx.green, l.fx.blue, 0), true, -1, true, 15) \
+  X(TWINKLE_RANDOM, "TwinkleRandom", l.TwinkleRandom(20, 100, false), true, -1, false, 6) \
+  X(TWINKLE,        "Twinkle",       l.Twinkle(l.fx.red, l.fx.green, l.fx.blue, 10, 100, false), true, -1, true, 7) \
+  X(RAINBOW,        "rainbow",       l.rainbow(l.velocity / 5), true, -1, false, 53) \
+  X(METEOR_RAIN,    "meteorRain",    l.meteorRain(l.fixedRed(0xff), l.fixedGreen(0xff), l.fixedBlue(0xff), 10, 64, true, 30), true, OVERLAY_STROBE, true, 72) \
+  X(RUNNING_LIGHTS, "RunningLights", l.RunningLights(l.fx.red, l.fx.green, l.fx.blue, 50), true, -1, true, 47) \
+  X(NEW_KITT,       "NewKITT",       l.NewKITT(l.fx.red, l.fx.green, l.fx.blue, 8, 10, 50), true, -1, true, 4) \
+  X(FADE_IN_OUT,    "FadeInOut",     l.FadeInOut(l.fx.red, l.fx.green, l.fx.blue), true, -1, true, 38) \
+  X(COLOR_WIPE,     "colorWipe",     l.colorWipe(PixelSink::Color(l.fx.red, l.fx.green, l.fx.blue), l.velocity), true, -1, true, 8) \
+  X(THEATER_CHASE,  "theaterChase",  l.theaterChase(PixelSink::Color(l.fx.red, l.fx.green, l.fx.blue), l.velocity), true, -1, true, 45) \
+  X(THEATER_CHASE_RAINBOW, "theaterChaseRainbow", l.theaterChaseRainbow(l.velocity), true, -1, false, 48) \
+  X(FIRE,           "Fire",          l.Fire(55, 120, 15, 1 + l.numPixels() / 150), true, -1, false, 61) \
+  X(RGB_LOOP,       "RGBLoop",       l.RGBLoop(), true, -1, false, 44) \
+  X(HALLOWEEN_EYES, "HalloweenEyes", l.HalloweenEyes(l.fixedRed(0xff), l.fixedGreen(0x00), l.fixedBlue(0x00), 1, 4, true, 10, 80, 3000), true, -1, true, 4) \
+  X(CYLON_BOUNCE,   "CylonBounce",   l.CylonBounce(l.fx.red, l.fx.green, l.fx.blue, 4, 10, 50), true, -1, true, 4) \
+  X(STROBE,         "Strobe",        l.Strobe(l.fixedRed(0xff), l.fixedGreen(0xff), l.fixedBlue(0xff), 10, 50, 1000), true, -1, true, 42) \
+  X(OVERLAY_STROBE, "StrobeBursts",  l.StrobeBursts(l.fixedRed(0xff), l.fixedGreen(0xff), l.fixedBlue(0xff), 10, 50, 6000), false, -1, true, 41) \
+  X(STREAM_INPUT,   "StreamInput",   l.StreamInput(), false, -1, false, 1) \
+  X(AUDIO_METEOR,   "meteorRainAudio", l.meteorRain(l.fixedRed(0xff), l.fixedGreen(0xff), l.fixedBlue(0xff), 10, 64, true, 40 - l.audioLevel() * 35 / 255), false, -1, true, 56) \
+  X(AUDIO_SPECTRUM, "SpectrumBars",  l.SpectrumBars(10), false, -1, false, 9) \
+  X(AUDIO_STROBE,   "BeatStrobe",    l.BeatFlash(l.fixedRed(0xff), l.fixedGreen(0xff), l.fixedBlue(0xff), false, 10), false, -1, true, 14) \
+  X(AUDIO_SPARKLE,  "BeatSparkle",   l.BeatFlash(l.fx.red, l.fx.green, l.fx.blue, true, 10), false, -1, true, 14) \
+  X(RAINBOW_2D,     "rainbow2D",     l.rainbow2D(l.velocity / 5), false, -1, false, 52) \
+  X(FIRE_2D,        "Fire2D",        l.Fire2D(55, 120, 15), false, -1, false, 61) \
+  X(RUNNING_LIGHTS_2D, "RunningLights2D", l.RunningLights2D(l.fx.red, l.fx.green, l.fx.blue, 50), false, -1, true, 49)
+
+#define LED_EFFECT_ID(id, name, frame, rotation, overlay, colors, budget) id,
+enum {
+  LED_EFFECT_LIST(LED_EFFECT_ID)
+  LED_EFFECTS // number of effects
+};
+#undef LED_EFFECT_ID
 
 class LED {
 
   public:
+    // How a layer is combined with what is below it
+    enum BlendMode {
+      BLEND_ALPHA,    // layer alpha/255 over the pixels below
+      BLEND_ADD,      // add the layer (scaled by alpha), black is transparent
+      BLEND_MAX,      // the brighter of layer and pixels below, per channel,
+                      // mixed in by alpha
+      BLEND_MULTIPLY  // the layer scales the pixels below, white keeps them,
+                      // mixed in by alpha
+    };
+
     LED(int ledCount, int pin);
+    // Drive any pixel sink, e.g. a recording sink in the host build.
+    // The sink is not owned by LED.
+    LED(PixelSink* sink);
+    // Several strips, one after the other in LED numbering. Use an
+    // asynchronous sink (see asyncsink.h) to render the next frame while
+    // the last one is being sent.
+    LED(PixelSink** sinks, int count);
+    // Same, with all per LED data in 'buffer' (2 byte aligned, at least
+    // LED_BUFFER_SIZE(LEDs of all sinks) bytes) instead of on the heap.
+    // Sinks that do not fit into it are left out.
+    LED(PixelSink** sinks, int count, uint8_t* buffer, size_t size);
     ~LED();
-    
+
     void loop();
+    // Render at most one frame of the running effect if it is due by 'now'
+    // (in ms) and return right away otherwise.
+    void step(unsigned long now);
+    // Run only the given effect from now on.
+    void setEffect(int effect);
+    // Same, with these colors instead of random ones or its own (effects
+    // without takesColors() keep theirs)
+    void setEffect(int effect, byte red, byte green, byte blue);
+    void setBrightness(int brightness);
+    int getBrightness() const { return brightness; }
+    void setVelocity(int velocity);
+    // Crossfade time (ms) to the next effects (0 = switch right away)
+    void setTransition(unsigned long ms);
+    // Temporal dithering of the levels between two 8 bit values (on by
+    // default unless a strip sends with the interrupts off, see
+    // PixelSink::blocksInterrupts()). Off, they are rounded and only new
+    // frames are sent.
+    void setDithering(boolean on);
+    void setTargetFps(int fps);
+    // Dim all strips as far as needed to stay within 'milliamps' of
+    // estimated current (0 = no limit)
+    void setPowerBudget(unsigned long milliamps);
+    unsigned long estimatedMilliamps() const;
+    // Whether the running sum the estimate is based on matches the levels
+    // sent, counted again (for the host tests)
+    boolean checkLoad() const;
+    // Start over with another seed, e.g. from analogRead() for a different
+    // show on every start. Takes effect with the next effect run.
+    void setSeed(uint32_t seed);
+    // False for an effect id out of range, or when all layers are in use
+    boolean addLayer(int effect, BlendMode mode, byte alpha);
+    void clearLayers();
+    // False for LEDs outside the strips or an effect id out of range.
+    // Segment 0 runs the rotation, its effect is -1.
+    boolean setSegment(int segment, int start, int length, int effect);
+    // Matrix or column the LEDs of a segment form, for the 2D effects
+    // (not owned by LED, nullptr for a plain strip). It may not have more
+    // cells than the segment has LEDs.
+    boolean setLayout(int segment, const Layout* layout);
+    // Source of the STREAM_INPUT effect (not owned by LED). Its frames are
+    // shown as soon as they are complete.
+    void setInput(PixelInput* input);
+    // Music analysis for the audio effects (not owned by LED), polled
+    // between frames; Audio::begin() starts its sampling
+    void setAudio(Audio* audio);
+    // Show played between frames (not owned by LED, nullptr to stop it).
+    // It starts right away and takes over the effect choice.
+    void setSequence(Sequence* sequence);
+    // Whether the Nextion display is on the serial line (the default). Turn
+    // it off before the first loop() when the line is used for something
+    // else, e.g. Adalight; LED then neither reads from nor writes to it.
+    void setDisplay(boolean on);
+    // Render and show time per frame and the number of frames that took
+    // longer than the target frame period
+    void printStats(Print& out);
+
+    // Effect numbers run from 0 to numEffects-1
+    static const int numEffects;
+    static const char* effectName(int effect);
+    // Whether the effect draws in the colors given to setEffect()
+    static boolean takesColors(int effect);
 
     boolean randomEffect = true;
+    unsigned long frames = 0; // rendered so far
   private:
-    Adafruit_NeoPixel* strip = nullptr;
-    
+    // Everything an effect needs to continue its animation on the next call.
+    // Effects render exactly one frame per call and return the time (in ms)
+    // until the next frame is due. On the last frame of a phase they set
+    // 'done'; effects built from several parts set 'phases' accordingly.
+    struct EffectState {
+      int effect = -1;
+      unsigned long frame = 0; // frame within the current phase
+      unsigned long due = 0;   // millis() at which the next frame is due
+      boolean done = false;    // current phase has rendered its last frame
+      byte phase = 0;
+      byte phases = 1;
+      byte red = 0, green = 0, blue = 0; // colors picked for the current run
+      byte variant = 0;        // effect specific choice for the current run
+      boolean fixed = false;   // red, green, blue given, not picked
+      int pixel = -1;          // effect specific pixel, kept between runs
+      Rng rng;                 // random numbers of this run
+    };
+
+    // A part of the LEDs running its own effect
+    struct Segment {
+      EffectState fx; // unused for segment 0, the rotation runs in 'fx'
+      int start = 0;
+      int length = 0;
+      const Layout* layout = nullptr;
+    };
+
+    PixelSink* outputs[LED_OUTPUTS] = {};
+    int outputStart[LED_OUTPUTS] = {}; // first LED of each output
+    int numOutputs = 0;
+    boolean ownsOutputs = false;
+    Segment segments[LED_SEGMENTS];
+    int numSegments = 1;
+
+    // Holds everything kept per LED, see LED_BUFFER_SIZE
+    uint8_t* buffer = nullptr;
+    size_t bufferSize = 0;
+    boolean ownsBuffer = false;
+    // Frame of all LEDs (r,g,b each) and the range of LEDs that changed
+    // since the last commit()
+    uint8_t* frame = nullptr;
+    int totalLeds = 0;
+    int dirtyFrom = 0;
+    int dirtyTo = 0;
+    // Changes held back per output while it was busy sending
+    int pendingFrom[LED_OUTPUTS] = {};
+    int pendingTo[LED_OUTPUTS] = {};
+    boolean pending = false;
+    // The LEDs the effect being rendered draws on: 'numLeds' from
+    // 'viewStart' on, at 'pixels' in its buffer
+    uint8_t* pixels = nullptr;
+    int viewStart = 0;
+    int numLeds = 0;
+    const Layout* grid = nullptr; // layout of the view, if any
+    byte* heat = nullptr; // Fire's heat per LED
+    // Rainbow colors and the fixed hue offset of every LED along the strip
+    Palette hueRing;
+    uint16_t* hueOffsets = nullptr;
+
+    Rng rng; // picks the effects and seeds their runs
+
+    // r+g+b of every LED as last sent and the sum over all of them, kept
+    // up to date pixel by pixel as they are sent
+    uint16_t* levels = nullptr;
+    unsigned long load = 0;
+    unsigned long powerBudget = 0;
+    byte shownBrightness = 50; // brightness the frame is scaled to
+
+    // Every channel as sent, after brightness, in 8.8 fixed point, and
+    // the fraction of it still owed to the LED. With dithering each push
+    // adds the fraction to the residual and sends the carry, so over a few
+    // frames the LED averages the exact level. 'grain' counts the LEDs per
+    // output with a fraction, those outputs are pushed again while no new
+    // frame is due.
+    uint16_t* wide = nullptr;
+    uint8_t* residual = nullptr;
+    int grain[LED_OUTPUTS] = {};
+    boolean dithering = true;
+    unsigned long refreshes = 0;
+
     int brightness = 50; // (max = 255)
     int velocity = 50;
 
-    const int numEffects = 11;
+    // Entry of the effect table, made from LED_EFFECT_LIST
+    struct EffectInfo {
+      const char* name;
+      int (*step)(LED& led); // renders one frame, returns the wait in ms
+      boolean rotation;      // picked by nextEffect()
+      int overlay;           // effect layered on top of it, -1 for none
+      boolean colors;        // draws in fx.red, fx.green, fx.blue
+    };
+    static const EffectInfo effects[];
+
     int effect = -1;
     boolean staticEffect = false;
+    // Colors of the effect set with setEffect(effect, red, green, blue)
+    boolean effectColors = false;
+    byte effectRed = 0, effectGreen = 0, effectBlue = 0;
+    EffectState fx;
+    boolean swapped = false; // 'fx' holds another state, see runEffect()
+
+    // Effect being faded out and its frame buffer while a transition runs
+    EffectState outgoing;
+    uint8_t* outgoingFrame = nullptr;
+    boolean transition = false;
+    unsigned long transitionStart = 0;
+    unsigned long transitionMs = LED_TRANSITION_MS;
+
+    // Effects rendering on top of the running one, in their own buffers
+    struct Layer {
+      EffectState fx;
+      uint8_t* frame = nullptr;
+      BlendMode mode = BLEND_ADD;
+      byte alpha = 255;
+    };
+    Layer layers[LED_LAYERS];
+    int numLayers = 0;
+
+    PixelInput* input = nullptr;
+    Audio* audio = nullptr;
+    Sequence* sequence = nullptr;
+
+    unsigned long framePeriod = 0; // us per frame at the target fps
+    unsigned long nextTick = 0;    // micros() at which the next frame may start
+    unsigned long overruns = 0;
+    FrameStats renderStats;
+    FrameStats showStats;
 
+    unsigned long lastPoll = 0;   // last time the display was polled
+    unsigned long lastUpdate = 0; // last time the display was written
+    int shownEffect = -1;         // effect number the display shows
+    Display nextion{Serial};
+    boolean display = true;
+    boolean displayStarted = false;
+
+    void touch(uint8_t component, uint32_t value);
+    void startDisplay();
+    void updateDisplay(unsigned long now);
+
+    void begin();
     void nextEffect();
+    int render();
+    // The colors given to setEffect(), or the effect's own ones
+    byte fixedRed(byte own) const { return fx.fixed ? fx.red : own; }
+    byte fixedGreen(byte own) const { return fx.fixed ? fx.green : own; }
+    byte fixedBlue(byte own) const { return fx.fixed ? fx.blue : own; }
+    void advance(unsigned long now);
+    boolean isDue(const EffectState& state, unsigned long now) const;
+    void runEffect(EffectState& state, uint8_t* buffer, const Segment& segment, unsigned long now);
+    void setView(uint8_t* buffer, const Segment& segment);
+    void startEffect(EffectState& state, int effect);
+    void swapEffect(EffectState& state);
+    void pollInput(unsigned long now);
+
+    int colorWipe(uint32_t color, int wait);
+    int theaterChase(uint32_t color, int wait);
+    int rainbow(int wait);
+    int theaterChaseRainbow(int wait);
+    int RGBLoop();
+    int FadeInOut(byte red, byte green, byte blue);
+    int meteorRain(byte red, byte green, byte blue, byte meteorSize, byte meteorTrailDecay, boolean meteorRandomDecay, int SpeedDelay);
+    int Strobe(byte red, byte green, byte blue, int StrobeCount, int FlashDelay, int EndPause);
+    int StrobeBursts(byte red, byte green, byte blue, int StrobeCount, int FlashDelay, int MaxPause);
+    int HalloweenEyes(byte red, byte green, byte blue, int EyeWidth, int EyeSpace, boolean Fade, int Steps, int FadeDelay, int EndPause);
+    int CylonBounce(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
+
+    int NewKITT(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
+    int CenterToOutside(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
+    int OutsideToCenter(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
+    int LeftToRight(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
+    int RightToLeft(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
+    int Scanner(byte red, byte green, byte blue, int EyeSize, int Falloff,
+                int from, int to, boolean mirror, int SpeedDelay, int ReturnDelay);
 
-    void colorWipe(uint32_t color, int wait);
-    void theaterChase(uint32_t color, int wait);
-    void rainbow(int wait);
-    void theaterChaseRainbow(int wait);
-    void RGBLoop();
-    void FadeInOut(byte red, byte green, byte blue);
-    void meteorRain(byte red, byte green, byte blue, byte meteorSize, byte meteorTrailDecay, boolean meteorRandomDecay, int SpeedDelay);
-    void Strobe(byte red, byte green, byte blue, int StrobeCount, int FlashDelay, int EndPause);
-    void HalloweenEyes(byte red, byte green, byte blue, int EyeWidth, int EyeSpace, boolean Fade, int Steps, int FadeDelay, int EndPause);
-    void CylonBounce(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
-
-    void NewKITT(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
-    void CenterToOutside(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
-    void OutsideToCenter(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
-    void LeftToRight(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
-    void RightToLeft(byte red, byte green, byte blue, int EyeSize, int SpeedDelay, int ReturnDelay);
-
-    void Twinkle(byte red, byte green, byte blue, int Count, int SpeedDelay, boolean OnlyOne);
-    void TwinkleRandom(int Count, int SpeedDelay, boolean OnlyOne);
-    void Sparkle(byte red, byte green, byte blue, int SpeedDelay);
-    void SnowSparkle(byte red, byte green, byte blue, int SparkleDelay, int SpeedDelay);
-    
-    void RunningLights(byte red, byte green, byte blue, int WaveDelay);
-
-    void Fire(int Cooling, int Sparking, int SpeedDelay);
+    int Twinkle(byte red, byte green, byte blue, int Count, int SpeedDelay, boolean OnlyOne);
+    int TwinkleRandom(int Count, int SpeedDelay, boolean OnlyOne);
+    int Sparkle(byte red, byte green, byte blue, int SpeedDelay);
+    int SnowSparkle(byte red, byte green, byte blue, int SparkleDelay, int SpeedDelay);
+
+    int RunningLights(byte red, byte green, byte blue, int WaveDelay);
+
+    int StreamInput();
+    int SpectrumBars(int SpeedDelay);
+    int BeatFlash(byte red, byte green, byte blue, boolean sparkle, int SpeedDelay);
+    byte audioLevel() const { return audio != nullptr ? audio->level() : 0; }
+
+    int Fire(int Cooling, int Sparking, int SpeedDelay, int Zones);
+    void burn(byte* cell, int numLeds, int Cooling, int Sparking);
+    int rainbow2D(int wait);
+    int Fire2D(int Cooling, int Sparking, int SpeedDelay);
+    int RunningLights2D(byte red, byte green, byte blue, int WaveDelay);
     void setPixelHeatColor (int Pixel, byte temperature);
 
-    void fadeToBlack(int ledNo, byte fadeValue);
+    void fadeToBlack(byte fadeValue, boolean randomDecay);
     void setAll(byte red, byte green, byte blue);
+
+    int numPixels() const { return numLeds; }
+    void setPixel(int n, byte red, byte green, byte blue);
+    void setPixel(int n, uint32_t color);
+    uint32_t getPixel(int n) const;
+    boolean commit(unsigned long now, boolean tick = false);
+    boolean canShow(int o);
+    void composite(int o, int from, int to, uint16_t alpha);
+    void send(int o, int i, uint16_t r, uint16_t g, uint16_t b);
+    void push(int o, int i);
+    void dither(int o, int from, int to);
+    unsigned long milliamps(byte brightness) const;
+    byte limitedBrightness() const;
 };
 
-#endif __LED_H__
+#endif // __LED_H__
@@ -2,18 +2,127 @@
 
 #define LED_PIN    D6
 #define LED_COUNT 100
+// Current the power supply can deliver to the strips (mA)
+#define LED_POWER_BUDGET 2000
+
+// All strips driven by the controller, in LED numbering order. Add more
+// NeoPixelSinks (pin, count) here for further strips. Set STRIP_ASYNC to 1
+// to send in the background instead, through the UART on D4 (asyncsink.h).
+#define STRIP_ASYNC 0
+#if STRIP_ASYNC
+#include "asyncsink.h"
+UartPixelSink strip(LED_COUNT);
+#else
+NeoPixelSink strip(LED_COUNT, LED_PIN, NEO_BRG + NEO_KHZ800);
+#endif
+PixelSink* strips[] = { &strip };
+
+// Set to 1 to show Adalight frames from a PC instead of the effects. The
+// PC then has the serial line, the Nextion is not used.
+// The bit-banged NeoPixelSink keeps interrupts off for about 30us per LED
+// while it sends, and the serial input can only hold the 128 bytes of the
+// UART FIFO in that time, so what arrives at STREAM_BAUD (10 bits per
+// byte) during a show of LED_COUNT LEDs has to fit in those. For more LEDs
+// lower the baud rate or send in the background (STRIP_ASYNC).
+#define STREAM_SERIAL 0
+#define STREAM_BAUD 250000
+#if STREAM_SERIAL && !STRIP_ASYNC && STREAM_BAUD / 10 * LED_COUNT * 30 / 1000000 >= 128
+#error "STREAM_BAUD overruns the UART FIFO while NeoPixelSink shows LED_COUNT LEDs"
+#endif
+
+// Set to 1 to print the frame statistics (render and show time, overruns,
+// power) every STATS_MS for a serial monitor. The serial line is then not
+// used for the Nextion either.
+#define STATS_SERIAL 0
+#define STATS_BAUD 115200
+#define STATS_MS 5000
+#if STATS_SERIAL && STREAM_SERIAL
+#error "STATS_SERIAL and STREAM_SERIAL both need the serial line"
+#endif
+
+// RAM for the controller's per LED data (all strips together), reserved at
+// build time; the "Global variables use ..." line of the build includes it.
+// Nothing is allocated once the sketch runs. (Each Adafruit_NeoPixel still
+// takes its pixel memory from the heap once, at startup.)
+#define LED_RAM_BUDGET 20000
+alignas(4) uint8_t ledBuffer[LED_BUFFER_SIZE(LED_COUNT)];
+static_assert(sizeof(ledBuffer) + sizeof(LED) <= LED_RAM_BUDGET,
+              "LED_COUNT needs more RAM than LED_RAM_BUDGET");
+
+// Set to 1 with a microphone amplifier on A0 for the audio effects
+// (AUDIO_METEOR, AUDIO_SPECTRUM, AUDIO_STROBE, AUDIO_SPARKLE)
+#define AUDIO_INPUT 0
 
 LED* led = nullptr;
+AdalightInput adalight(Serial);
+AnalogSource microphone(A0);
+Audio audio(microphone);
+
+// Set to 1 when the LEDs form a matrix of MATRIX_WIDTH x MATRIX_HEIGHT,
+// wired in rows that snake back and forth, for the 2D effects
+// (RAINBOW_2D, FIRE_2D, RUNNING_LIGHTS_2D)
+#define MATRIX 0
+#define MATRIX_WIDTH  10
+#define MATRIX_HEIGHT 10
+uint16_t matrixTable[MATRIX_WIDTH * MATRIX_HEIGHT];
+Layout matrix(matrixTable, MATRIX_WIDTH, MATRIX_HEIGHT);
+
+// Set to 1 to play the show in show.h instead of the effect rotation.
+// show.h is made from show.txt with the ledseq host tool.
+#define SEQUENCE 0
+#include "show.h"
+Sequence sequence(show);
 
 void setup() {
+#if STREAM_SERIAL
+  Serial.setRxBufferSize(1024);
+  Serial.begin(STREAM_BAUD);
+#elif STATS_SERIAL
+  Serial.begin(STATS_BAUD);
+#else
   Serial.begin(9600);
   Serial.write(0xff);
   Serial.write(0xff);
   Serial.write(0xff);
-  led = new LED(LED_COUNT, LED_PIN);
+#endif
+  // Static, but only constructed here: it sets up the strips
+  static LED controller(strips, sizeof(strips) / sizeof(strips[0]), ledBuffer, sizeof(ledBuffer));
+  led = &controller;
+  led->setPowerBudget(LED_POWER_BUDGET);
+#if STATS_SERIAL
+  led->setDisplay(false);
+#endif
+#if MATRIX
+  matrix.matrix(true);
+  led->setLayout(0, &matrix);
+  led->setEffect(FIRE_2D);
+#endif
+#if AUDIO_INPUT
+  led->setAudio(&audio);
+  led->setEffect(AUDIO_SPECTRUM);
+  audio.begin();
+#endif
+#if SEQUENCE
+  led->setSequence(&sequence);
+#endif
+#if STREAM_SERIAL
+  led->setDisplay(false);
+  led->setInput(&adalight);
+  led->setEffect(STREAM_INPUT);
+#endif
+  // Segments run their own effect, e.g. Fire on the last 20 LEDs:
+  //   led->setSegment(0, 0, LED_COUNT - 20, -1);
+  //   led->setSegment(1, LED_COUNT - 20, 20, 12);
 }
 
 
 void loop() {
   led->loop();
+#if STATS_SERIAL
+  static unsigned long lastStats = 0;
+  if(millis() - lastStats >= STATS_MS) {
+    lastStats = millis();
+    led->printStats(Serial);
+  }
+#endif
 }
@@ -0,0 +1,11 @@
+#include "palette.h"
+#include "pixelsink.h"
+
+void Palette::setHueRing() {
+  for(int i = 0; i < 256; i++) {
+    uint32_t c = PixelSink::gamma32(PixelSink::ColorHSV(i * 256));
+    colors[i][0] = c >> 16;
+    colors[i][1] = c >> 8;
+    colors[i][2] = c;
+  }
+}
@@ -0,0 +1,23 @@
+#ifndef __PALETTE_H__
+#define __PALETTE_H__
+
+#include <Arduino.h>
+
+// 256 precomputed colors, indexed by the high byte of a 16 bit position
+// (e.g. a hue). Looking a color up replaces the per pixel HSV and gamma
+// math of the effects.
+class Palette {
+
+  public:
+    // Gamma corrected color wheel, entry i holds hue i*256
+    void setHueRing();
+
+    const uint8_t* color(uint8_t index) const { return colors[index]; }
+    // Nearest entry for a 16 bit hue
+    const uint8_t* hue(uint16_t hue) const { return colors[(uint8_t)((hue + 128) >> 8)]; }
+
+  private:
+    uint8_t colors[256][3];
+};
+
+#endif // __PALETTE_H__
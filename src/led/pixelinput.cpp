@@ -0,0 +1,82 @@
+#include "pixelinput.h"
+
+boolean AdalightInput::poll(uint8_t* pixels, int count, int& from, int& to) {
+  int budget = STREAM_MAX_BYTES;
+  int available;
+  while(budget > 0 && (available = in.available()) > 0) {
+    if(state == DATA) {
+      // Pixel data goes straight into the frame, what does not fit is read
+      // and dropped
+      long chunk = min((long) min(available, budget), end - offset);
+      long limit = (long) count * 3;
+      if(offset < limit) {
+        chunk = in.readBytes(&pixels[offset], min(chunk, limit - offset));
+      }
+      else {
+        for(long i = 0; i < chunk; i++) {
+          in.read();
+        }
+      }
+      offset += chunk;
+      budget -= chunk;
+      if(offset >= end) {
+        state = MAGIC_A;
+        frames++;
+        from = start / 3;
+        to = min(end / 3, (long) count);
+        if(from < to) {
+          return true;
+        }
+      }
+      continue;
+    }
+
+    int c = in.read();
+    budget--;
+    switch(state) {
+      case MAGIC_A:
+        if(c == 'A') {
+          state = MAGIC_D;
+        }
+        break;
+      case MAGIC_D:
+        state = c == 'd' ? MAGIC_TYPE : c == 'A' ? MAGIC_D : MAGIC_A;
+        break;
+      case MAGIC_TYPE:
+        if(c == 'a' || c == 'o') {
+          delta = c == 'o';
+          headerLength = 0;
+          state = HEADER;
+        }
+        else {
+          state = c == 'A' ? MAGIC_D : MAGIC_A;
+        }
+        break;
+      case HEADER: {
+        header[headerLength++] = c;
+        byte size = delta ? 5 : 3;
+        if(headerLength < size) {
+          break;
+        }
+        byte check = 0x55;
+        for(int i = 0; i < size - 1; i++) {
+          check ^= header[i];
+        }
+        if(check != header[size - 1]) {
+          errors++;
+          state = MAGIC_A;
+          break;
+        }
+        long first = delta ? (header[0] << 8) | header[1] : 0;
+        long n = ((header[size - 3] << 8) | header[size - 2]) + 1;
+        start = offset = first * 3;
+        end = (first + n) * 3;
+        state = DATA;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  return false;
+}
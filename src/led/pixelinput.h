@@ -0,0 +1,56 @@
+#ifndef __PIXELINPUT_H__
+#define __PIXELINPUT_H__
+
+#include <Arduino.h>
+
+// Most bytes an input reads per poll, so a flood of input can not hold up
+// rendering and the display
+#ifndef STREAM_MAX_BYTES
+#define STREAM_MAX_BYTES 1024
+#endif
+
+// Pixels sent from outside, e.g. by a PC. LED polls the input between
+// frames while a segment runs the STREAM_INPUT effect.
+class PixelInput {
+
+  public:
+    virtual ~PixelInput() {}
+
+    // Read what has arrived so far straight into 'pixels' (r,g,b for
+    // 'count' LEDs). Returns true when a frame is complete; 'from' and 'to'
+    // then are the LEDs it changed.
+    virtual boolean poll(uint8_t* pixels, int count, int& from, int& to) = 0;
+};
+
+// Adalight frames over a serial line:
+//   'A' 'd' 'a' n-1 (hi, lo) checksum, then n times r g b
+// with checksum = hi ^ lo ^ 0x55. A delta frame updates n LEDs from an
+// offset on:
+//   'A' 'd' 'o' offset (hi, lo) n-1 (hi, lo) checksum, r g b ...
+// with checksum = the xor of the four bytes ^ 0x55. Pixels past the end of
+// the segment are dropped. Every byte costs the same, a broken header only
+// makes the parser look for the next 'A'.
+class AdalightInput : public PixelInput {
+
+  public:
+    AdalightInput(Stream& in) : in(in) {}
+
+    boolean poll(uint8_t* pixels, int count, int& from, int& to);
+
+    unsigned long frames = 0;
+    unsigned long errors = 0; // headers with a wrong checksum
+
+  private:
+    enum State { MAGIC_A, MAGIC_D, MAGIC_TYPE, HEADER, DATA };
+
+    Stream& in;
+    State state = MAGIC_A;
+    boolean delta = false;
+    byte header[5];
+    byte headerLength = 0;
+    long start = 0;  // the frame's data in bytes from the first LED on
+    long offset = 0; // next byte to read
+    long end = 0;
+};
+
+#endif // __PIXELINPUT_H__
@@ -0,0 +1,61 @@
+#ifndef __PIXELSINK_H__
+#define __PIXELSINK_H__
+
+#include <Adafruit_NeoPixel.h>
+
+// Where LED sends its pixels. The sketch drives a NeoPixel strip through
+// NeoPixelSink, the host build records or discards the frames instead.
+class PixelSink {
+
+  public:
+    virtual ~PixelSink() {}
+
+    virtual void begin() {}
+    virtual uint16_t numPixels() const = 0;
+    virtual void setBrightness(uint8_t b) = 0;
+    virtual void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) = 0;
+    void setPixelColor(uint16_t n, uint32_t c) {
+      setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+    }
+    virtual uint32_t getPixelColor(uint16_t n) const = 0;
+    virtual void clear() = 0;
+    virtual void show() = 0;
+    // False while the previous frame is still going out. Asynchronous sinks
+    // return from show() right away and send in the background; LED keeps
+    // their changes until they can take the next frame.
+    virtual boolean canShow() { return true; }
+    // True when show() sends with the interrupts off, so the audio
+    // sampling timer can't fire meanwhile
+    virtual boolean blocksInterrupts() const { return false; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+      return Adafruit_NeoPixel::Color(r, g, b);
+    }
+    static uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255) {
+      return Adafruit_NeoPixel::ColorHSV(hue, sat, val);
+    }
+    static uint32_t gamma32(uint32_t x) {
+      return Adafruit_NeoPixel::gamma32(x);
+    }
+};
+
+class NeoPixelSink : public PixelSink {
+
+  public:
+    NeoPixelSink(uint16_t n, int16_t pin, neoPixelType type) : strip(n, pin, type) {}
+
+    void begin() { strip.begin(); }
+    uint16_t numPixels() const { return strip.numPixels(); }
+    void setBrightness(uint8_t b) { strip.setBrightness(b); }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) { strip.setPixelColor(n, r, g, b); }
+    using PixelSink::setPixelColor;
+    uint32_t getPixelColor(uint16_t n) const { return strip.getPixelColor(n); }
+    void clear() { strip.clear(); }
+    void show() { strip.show(); }
+    boolean blocksInterrupts() const { return true; } // bit-banged
+
+  private:
+    Adafruit_NeoPixel strip;
+};
+
+#endif // __PIXELSINK_H__
@@ -0,0 +1,26 @@
+#include "rng.h"
+
+void Rng::seed(uint32_t seed) {
+  // Spread the seed bits (xorshift must never start at 0)
+  seed = (seed ^ (seed >> 16)) * 0x45d9f3bUL;
+  seed = (seed ^ (seed >> 16)) * 0x45d9f3bUL;
+  state = (seed ^ (seed >> 16)) | 1;
+}
+
+void Rng::fill(uint8_t* bytes, int count) {
+  int i = 0;
+  for(; i + 4 <= count; i += 4) {
+    uint32_t r = next();
+    bytes[i] = r;
+    bytes[i+1] = r >> 8;
+    bytes[i+2] = r >> 16;
+    bytes[i+3] = r >> 24;
+  }
+  if(i < count) {
+    uint32_t r = next();
+    for(; i < count; i++) {
+      bytes[i] = r;
+      r >>= 8;
+    }
+  }
+}
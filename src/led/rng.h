@@ -0,0 +1,33 @@
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <Arduino.h>
+
+// Small xorshift32 generator for the effects. Every effect run has its own,
+// seeded from LED's, so a run only depends on the seed and never on what
+// other effects or layers drew before. A number costs three shifts and
+// three xors, against a division and a multiply for random().
+class Rng {
+
+  public:
+    Rng(uint32_t seed = 1) { this->seed(seed); }
+
+    void seed(uint32_t seed);
+    uint32_t next() {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state;
+    }
+    // 0 to n-1 (n up to 65536), like random(n)
+    uint32_t below(uint32_t n) { return ((next() >> 16) * n) >> 16; }
+    // lo to hi-1, like random(lo, hi)
+    long range(long lo, long hi) { return hi > lo ? lo + (long) below(hi - lo) : lo; }
+    // 'count' random bytes, four per step
+    void fill(uint8_t* bytes, int count);
+
+  private:
+    uint32_t state;
+};
+
+#endif // __RNG_H__
@@ -0,0 +1,96 @@
+#include "sequence.h"
+#include "led.h"
+
+boolean Sequence::start(unsigned long now) {
+  pc = nullptr;
+  rampMs = 0;
+  if(pgm_read_byte(&program[0]) != 'L' || pgm_read_byte(&program[1]) != 'S' ||
+     pgm_read_byte(&program[2]) != SEQ_VERSION) {
+    return false;
+  }
+  pc = &program[3];
+  due = now;
+  return true;
+}
+
+boolean Sequence::run(LED& led, unsigned long now) {
+  if(rampMs > 0) {
+    unsigned long t = now - rampStart;
+    if(t >= rampMs) {
+      led.setBrightness(rampTo);
+      rampMs = 0;
+    }
+    else {
+      led.setBrightness(rampFrom + (long) (rampTo - rampFrom) * (long) t / (long) rampMs);
+    }
+  }
+
+  // Waits count from when they were due, so a late call does not shift
+  // the rest of the show
+  for(int steps = 0; pc != nullptr && steps < SEQ_MAX_STEPS && (long)(now - due) >= 0; steps++) {
+    const uint8_t op = next();
+    commands++;
+    switch(op) {
+      case SEQ_EFFECT: {
+        const uint8_t effect = next();
+        if(effect >= LED::numEffects) {
+          pc = nullptr;
+          break;
+        }
+        led.setEffect(effect);
+        break;
+      }
+      case SEQ_EFFECT_COLOR: {
+        const uint8_t effect = next();
+        const uint8_t red = next();
+        const uint8_t green = next();
+        const uint8_t blue = next();
+        if(effect >= LED::numEffects) {
+          pc = nullptr;
+          break;
+        }
+        led.setEffect(effect, red, green, blue);
+        break;
+      }
+      case SEQ_WAIT:
+        due += next16();
+        break;
+      case SEQ_BRIGHTNESS:
+        rampFrom = led.getBrightness();
+        rampTo = next();
+        rampMs = next16();
+        rampStart = due;
+        if(rampMs == 0) {
+          led.setBrightness(rampTo);
+        }
+        break;
+      case SEQ_VELOCITY:
+        led.setVelocity(next());
+        break;
+      case SEQ_TRANSITION:
+        led.setTransition(next16());
+        break;
+      case SEQ_LAYER: {
+        const uint8_t effect = next();
+        const uint8_t mode = next();
+        const uint8_t alpha = next();
+        if(effect >= LED::numEffects || mode > LED::BLEND_MULTIPLY) {
+          pc = nullptr;
+          break;
+        }
+        led.addLayer(effect, (LED::BlendMode) mode, alpha);
+        break;
+      }
+      case SEQ_CLEAR_LAYERS:
+        led.clearLayers();
+        break;
+      case SEQ_LOOP:
+        pc = &program[3];
+        break;
+      default: // SEQ_END, or not a command
+        pc = nullptr;
+        break;
+    }
+  }
+  return pc != nullptr;
+}
@@ -0,0 +1,69 @@
+#ifndef __SEQUENCE_H__
+#define __SEQUENCE_H__
+
+#include <Arduino.h>
+
+class LED;
+
+// A show as a program in flash: 'L' 'S' version, then commands of an
+// opcode byte and fixed operands (16 bit values little endian). Written
+// from a text file by the ledseq host tool, e.g.
+//
+//   transition 500
+//   effect FadeInOut 255 0 0   # effect with colors
+//   brightness 10 over 2000    # ramp, keeps running during the waits
+//   wait 4000
+//   loop
+#define SEQ_VERSION 1
+
+#define SEQ_END          0x00 // stop, the last effect keeps running
+#define SEQ_EFFECT       0x01 // effect: colors picked at random
+#define SEQ_EFFECT_COLOR 0x02 // effect, red, green, blue
+#define SEQ_WAIT         0x03 // ms (16)
+#define SEQ_BRIGHTNESS   0x04 // level, ms (16) to get there (0 = now)
+#define SEQ_VELOCITY     0x05 // ms per step of colorWipe, theaterChase, rainbow
+#define SEQ_TRANSITION   0x06 // ms (16) of the crossfades from now on
+#define SEQ_LAYER        0x07 // effect, blend mode, alpha
+#define SEQ_CLEAR_LAYERS 0x08
+#define SEQ_LOOP         0x09 // start over with the first command
+
+// Most commands run in one call, so a program without waits can not hold
+// up the frames
+#define SEQ_MAX_STEPS 16
+
+// Plays a program from PROGMEM on an LED, see LED::setSequence(). It only
+// keeps a pointer into the program and the time the next command is due;
+// LED runs it between frames, where it costs a comparison unless a
+// command is due or the brightness ramps.
+class Sequence {
+
+  public:
+    Sequence(const uint8_t* program) : program(program) {}
+
+    // Start from the first command at 'now' (ms). False if the program
+    // does not start with the header.
+    boolean start(unsigned long now);
+    // Run the commands due by 'now'. False once the program has ended.
+    boolean run(LED& led, unsigned long now);
+
+    unsigned long commands = 0; // run so far
+
+  private:
+    uint8_t next() { return pgm_read_byte(pc++); }
+    uint16_t next16() {
+      uint16_t value = next();
+      return value | (next() << 8);
+    }
+
+    const uint8_t* program;
+    const uint8_t* pc = nullptr; // next command, nullptr once stopped
+    unsigned long due = 0;       // when it runs (ms)
+
+    // Brightness ramp of the last SEQ_BRIGHTNESS
+    int rampFrom = 0;
+    int rampTo = 0;
+    unsigned long rampStart = 0;
+    unsigned long rampMs = 0;
+};
+
+#endif // __SEQUENCE_H__
@@ -0,0 +1,33 @@
+#ifndef __SHOW_H__
+#define __SHOW_H__
+
+// Generated by ledseq from show.txt, 73 bytes
+
+#include <Arduino.h>
+
+const uint8_t show[] PROGMEM = {
+  'L', 'S', 1,
+  0x06, 0xe8, 0x03,             // transition 1000
+  0x04, 0x32, 0x00, 0x00,       // brightness 50
+  0x02, 0x08, 0xff, 0x28, 0x00, // effect FadeInOut 255 40 0
+  0x03, 0x40, 0x1f,             // wait 8000
+  0x01, 0x04,                   // effect rainbow
+  0x05, 0x14,                   // velocity 20
+  0x04, 0x78, 0xa0, 0x0f,       // brightness 120 over 4000
+  0x03, 0x10, 0x27,             // wait 10000
+  0x04, 0x32, 0xd0, 0x07,       // brightness 50 over 2000
+  0x01, 0x0c,                   // effect Fire
+  0x03, 0x98, 0x3a,             // wait 15000
+  0x02, 0x06, 0x00, 0x50, 0xff, // effect RunningLights 0 80 255
+  0x07, 0x01, 0x01, 0x80,       // layer Sparkle add 128
+  0x03, 0x10, 0x27,             // wait 10000
+  0x06, 0x00, 0x00,             // transition 0
+  0x02, 0x10, 0xff, 0xff, 0xff, // effect Strobe 255 255 255
+  0x03, 0xb8, 0x0b,             // wait 3000
+  0x06, 0xe8, 0x03,             // transition 1000
+  0x02, 0x05, 0xff, 0xff, 0xff, // effect meteorRain 255 255 255
+  0x03, 0xe0, 0x2e,             // wait 12000
+  0x09,                         // loop
+};
+
+#endif // __SHOW_H__